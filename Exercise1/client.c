@@ -0,0 +1,109 @@
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <stdbool.h>
+
+#include <unistd.h>
+#include <sys/socket.h>
+#include <sys/un.h>
+
+#include<readline/readline.h>
+
+/*protected functions*/
+bool send_line (int fd, const char* line);
+bool print_reply (int fd);
+
+   	/* 
+	 * PURPOSE: a command line client for a matlab server started with -s
+	 * INPUT: 
+	 *	argc - the number of arguments
+	 *	argv - the socket path of the server
+	 * RETURN:
+	 *  0 - if the client exits successfully
+	 *  -1 - if the client fails to connect or the connection is lost
+	 * 
+	 */
+int main (int argc, char **argv) {
+
+	if (argc != 2) {
+		fprintf(stderr, "usage: %s <socket_path>\n", argv[0]);
+		return -1;
+	}
+
+	struct sockaddr_un addr;
+	memset(&addr, 0, sizeof(addr));
+	addr.sun_family = AF_UNIX;
+	strncpy(addr.sun_path, argv[1], sizeof(addr.sun_path) - 1);
+
+	int fd = socket(AF_UNIX, SOCK_STREAM, 0);
+	if (fd < 0 || connect(fd, (struct sockaddr*)&addr, sizeof(addr))) {
+		perror("FAILED TO CONNECT TO SERVER\n");
+		return -1;
+	}
+
+	int status = 0;
+	char *line = readline("> ");
+	while (line && strncmp(line,"exit", strlen("exit")  + 1) != 0) {
+		if (!send_line(fd, line) || !print_reply(fd)) {
+			printf("Connection to the server lost\n");
+			status = -1;
+			break;
+		}
+		free(line);
+		line = readline("> ");
+	}
+	if (line && status == 0) {
+		send_line(fd, line);
+	}
+	free(line);
+	close(fd);
+	return status;
+}
+
+	/* 
+	 * PURPOSE: sends one command line to the server
+	 * INPUT: 
+	 *	fd - the connected socket
+	 *	line - the command without a newline
+	 * RETURN:
+	 *  True - if the whole line was sent
+	 *  False - if the connection failed
+	 */
+bool send_line (int fd, const char* line) {
+
+	const size_t len = strlen(line);
+	size_t sent = 0;
+	while (sent < len) {
+		ssize_t n = write(fd, line + sent, len - sent);
+		if (n <= 0) {
+			return false;
+		}
+		sent += n;
+	}
+	return write(fd, "\n", 1) == 1;
+}
+
+	/* 
+	 * PURPOSE: prints the reply of the server up to its terminating NUL byte
+	 * INPUT: 
+	 *	fd - the connected socket
+	 * RETURN:
+	 *  True - if a full reply was printed
+	 *  False - if the connection closed first
+	 */
+bool print_reply (int fd) {
+
+	char buffer[4096];
+	for (;;) {
+		ssize_t n = read(fd, buffer, sizeof(buffer));
+		if (n <= 0) {
+			return false;
+		}
+		char* end = memchr(buffer, '\0', n);
+		fwrite(buffer, 1, end ? end - buffer : n, stdout);
+		if (end) {
+			fflush(stdout);
+			return true;
+		}
+	}
+}
@@ -4,9 +4,9 @@
 #include <stdbool.h>
 
 #include "command.h"
+#include "matrix.h"
 
 #define MAX_CMD_COUNT 50
-#define MAX_CMD_LEN 25
 
 
  	/* 
@@ -21,27 +21,40 @@
 bool parse_user_input (const char* input, Commands_t** cmd) {
 	
 	if( !input ){
-		printf("Null input from the user.\n");
+		report("Null input from the user.\n");
 		return false;
-	}//TODO ERROR CHECK INCOMING PARAMETERS
+	}
 
 	char *string = strdup(input);
+	if (!string) {
+		return false;
+	}
 	
 	*cmd = calloc (1,sizeof(Commands_t));
+	if (!(*cmd)) {
+		free(string);
+		return false;
+	}
 	(*cmd)->cmds = calloc(MAX_CMD_COUNT,sizeof(char*));
+	if (!(*cmd)->cmds) {
+		free(string);
+		return false;
+	}
 
 	unsigned int i = 0;
 	char *token;
-	token = strtok(string, " \n");
+	/* strtok keeps its place in a static, strtok_r keeps it here so clients can parse at the same time */
+	char *save = NULL;
+	token = strtok_r(string, " \t\r\n", &save);
 	for (; token != NULL && i < MAX_CMD_COUNT; ++i) {
-		(*cmd)->cmds[i] = calloc(MAX_CMD_LEN,sizeof(char));
+		(*cmd)->cmds[i] = strdup(token);
 		if (!(*cmd)->cmds[i]) {
-			perror("Allocation Error\n");
+			report("Allocation Error\n");
+			free(string);
 			return false;
 		}	
-		strncpy((*cmd)->cmds[i],token, strlen(token) + 1);
 		(*cmd)->num_cmds++;
-		token = strtok(NULL, " \n");
+		token = strtok_r(NULL, " \t\r\n", &save);
 	}
 	free(string);
 	return true;
@@ -57,9 +70,9 @@ bool parse_user_input (const char* input, Commands_t** cmd) {
 void destroy_commands(Commands_t** cmd) {
 
 	if( !(*cmd) ){
-		printf("Null list of commands.\n");
+		report("Null list of commands.\n");
 		return;
-	}//TODO ERROR CHECK INCOMING PARAMETERS
+	}
 	
 	for (int i = 0; i < (*cmd)->num_cmds; ++i) {
 		free((*cmd)->cmds[i]);
@@ -4,25 +4,60 @@
 #include <limits.h>
 #include <math.h>
 #include <stdbool.h>
+#include <stdint.h>
+#include <ctype.h>
+#include <errno.h>
 #include <time.h>
+#include <unistd.h>
+#include <pthread.h>
+#include <glob.h>
+#include <sys/stat.h>
 
 #include<readline/readline.h>
 
 #include "command.h"
 #include "matrix.h"
+#include "server.h"
+#include "memory.h"
 
-void run_commands (Commands_t* cmd, Matrix_t** mats, unsigned int num_mats);
+#define NUM_MATS 512
+#define MAX_PRELOADS 64
+
+/* what to do before the first command, from the command line and config files */
+typedef struct {
+	char* socket_path;
+	bool temp_mat;
+}Startup_t;
+
+/* a matrix file that is only read the first time a command names it */
+typedef struct {
+	char name[MATRIX_NAME_LEN];
+	char* path;
+	bool done;
+}Preload_t;
+
+static Preload_t preloads[MAX_PRELOADS];
+static unsigned int num_preloads = 0;
+
+void run_commands (Commands_t* cmd, Matrix_t** mats, unsigned int num_mats, FILE* out);
 unsigned int find_matrix_given_name (Matrix_t** mats, unsigned int num_mats, 
 			const char* target);
 
 // TODO complete the defintion of this function. 
 void destroy_remaining_heap_allocations(Matrix_t **mats, unsigned int num_mats);
+bool read_config (const char* config_filename, Startup_t* startup);
+bool add_preload (const char* path);
+bool create_temp_mat (Matrix_t** mats, unsigned int num_mats);
+bool parse_megabytes (const char* text, size_t* bytes);
 
    	/* 
 	 * PURPOSE: the driver of the program
 	 * INPUT: 
 	 *	argc - the user's input
-	 *	argv - the list of matrices
+	 *	argv - the list of matrices, -s <socket_path> serves them to clients instead of the prompt,
+	 *		-m <megabytes> sets the memory budget for matrix data, -n skips making temp_mat,
+	 *		-p <matrix_file> reads the file the first time a command names it and -c <config_file>
+	 *		reads more of these settings from a file
 	 * RETURN:
 	 *  0 - if the program exits successfully
 	 *  -1 - if the program fails to initialize or other errors occur
@@ -32,71 +67,160 @@ int main (int argc, char **argv) {
 	srand(time(NULL));		
 	char *line = NULL;
 	Commands_t* cmd;
+	Startup_t startup = {.socket_path = NULL, .temp_mat = true};
 
-	Matrix_t *mats[10];
-	memset(&mats,0, sizeof(Matrix_t*) * 10); // IMPORTANT C FUNCTION TO LEARN
+	/* settings are applied in the order they are given, so later ones win */
+	int opt;
+	bool started = true;
+	while (started && (opt = getopt(argc, argv, "s:m:np:c:")) != -1) {
+		if (opt == 's') {
+			free(startup.socket_path);
+			startup.socket_path = strdup(optarg);
+		}
+		else if (opt == 'm') {
+			size_t budget = 0;
+			started = parse_megabytes(optarg, &budget);
+			if (started) {
+				set_memory_budget(budget);
+			}
+			else {
+				fprintf(stderr, "Bad memory budget (%s), give a number of megabytes\n", optarg);
+			}
+		}
+		else if (opt == 'n') {
+			startup.temp_mat = false;
+		}
+		else if (opt == 'p') {
+			started = add_preload(optarg);
+		}
+		else if (opt == 'c') {
+			started = read_config(optarg, &startup);
+		}
+		else {
+			fprintf(stderr, "usage: %s [-s socket_path] [-m megabytes] [-n] [-p matrix_file] [-c config_file]\n", argv[0]);
+			started = false;
+		}
+	}
 
-	Matrix_t *temp = NULL;
-	if(!(create_matrix (&temp,"temp_mat", 5, 5))){
-		perror("PROGRAM FAILED TO CREATE TMP MATRIX\n");
-		return -1;
-	} // TODO ERROR CHECK
-	if((add_matrix_to_array(mats,temp, 10)) == 99 ){
-		perror("PROGRAM FAILED TO ADD TMP MATRIX TO MATS ARRAY\n");
-		return -1;
-	} //TODO ERROR CHECK NEEDED
-	int mat_idx = find_matrix_given_name(mats,10,"temp_mat");
+	Matrix_t *mats[NUM_MATS];
+	memset(&mats,0, sizeof(Matrix_t*) * NUM_MATS); // IMPORTANT C FUNCTION TO LEARN
 
-	if (mat_idx < 0) {
-		perror("PROGRAM FAILED TO INIT\n");
-		return -1;
+	if (started && startup.temp_mat) {
+		started = create_temp_mat(mats, NUM_MATS);
 	}
-	random_matrix(mats[mat_idx], 10, 15);
-	if(!(write_matrix("temp_mat", mats[mat_idx]))){
-		perror("PROGRAM FAILED TO WRITE TMP MATRIX TO FILE\n");
-		return -1;
-	} // TODO ERROR CHECK
 
-	line = readline("> ");
-	while (strncmp(line,"exit", strlen("exit")  + 1) != 0) {
-		
-		if (!parse_user_input(line,&cmd)) {
-			printf("Failed at parsing command\n\n");
-		}
-		
-		if (cmd->num_cmds > 1) {	
-			run_commands(cmd,mats,10);
-		}
-		if (line) {
+	if (started && startup.socket_path) {
+		started = run_server(startup.socket_path, mats, NUM_MATS, run_commands);
+	}
+	else if (started) {
+		/* readline gives back NULL once the input runs out */
+		while ((line = readline("> ")) && strncmp(line,"exit", strlen("exit")  + 1) != 0) {
+			
+			if (!parse_user_input(line,&cmd)) {
+				report("Failed at parsing command\n\n");
+			}
+			else if (cmd->num_cmds > 0) {	
+				run_commands(cmd,mats,NUM_MATS,stdout);
+			}
 			free(line);
+			destroy_commands(&cmd);
+		}
+		if (!line) {
+			printf("\n");
 		}
-		destroy_commands(&cmd);
-		line = readline("> ");
+		free(line);
 	}
-	free(line);
-	destroy_remaining_heap_allocations(mats,10);
-	return 0;	
+
+	destroy_remaining_heap_allocations(mats,NUM_MATS);
+	for (unsigned int i = 0; i < num_preloads; ++i) {
+		free(preloads[i].path);
+	}
+	free(startup.socket_path);
+	return started ? 0 : -1;	
 }
 
+/* guards the mats array, commands that add matrices to it hold it exclusively */
+static pthread_rwlock_t mats_lock = PTHREAD_RWLOCK_INITIALIZER;
+
+static const char* array_commands[] = {"read", "readall", "create", "load_workspace", "slice", "mem"};
+
+bool execute_command (Commands_t* cmd, Matrix_t** mats, unsigned int num_mats, FILE* out, bool exclusive);
+bool find_named_matrices (Commands_t* cmd, unsigned int first, unsigned int count, Matrix_t** mats, unsigned int num_mats,
+			Matrix_t** found, FILE* out);
+Matrix_t* reusable_destination (Matrix_t** mats, unsigned int num_mats, const char* name,
+			unsigned int rows, unsigned int cols);
+bool names_spilled_matrix (Commands_t* cmd, Matrix_t** mats, unsigned int num_mats);
+bool names_preload (Commands_t* cmd, Matrix_t** mats, unsigned int num_mats);
+bool preload_named_matrices (Commands_t* cmd, Matrix_t** mats, unsigned int num_mats, FILE* out);
+const char** find_matrix_files (const char* target, glob_t* found, unsigned int* num_files);
+bool page_in_named_matrices (Commands_t* cmd, Matrix_t** mats, unsigned int num_mats, FILE* out);
+
   	/* 
-	 * PURPOSE: executes the command entered by the user
+	 * PURPOSE: executes the command entered by the user, safe to call from many threads at once
 	 * INPUT: 
 	 *	cmd - the user's input
 	 *	mats - the list of matrices
 	 *	num_mats - the number of matrices in the list
+	 *	out - the stream the results of the command are printed to
 	 * RETURN:
 	 * 
 	 */
-void run_commands (Commands_t* cmd, Matrix_t** mats, unsigned int num_mats) {
-	//TODO ERROR CHECK INCOMING PARAMETERS
-	if(!(cmd)){
-		printf("Null pointer to cmd sent to run_commands.\n");
+void run_commands (Commands_t* cmd, Matrix_t** mats, unsigned int num_mats, FILE* out) {
+	/* why a kernel or the allocator failed goes to the same stream as the result */
+	set_report_stream(out);
+	if(!(cmd) || cmd->num_cmds == 0){
+		report("Null pointer to cmd sent to run_commands.\n");
+		set_report_stream(NULL);
 		return;
 	}
-	else if(!(*mats)){
-		printf("Null pointer to mats sent to run_commands.\n");
+	else if(!(mats)){
+		report("Null pointer to mats sent to run_commands.\n");
+		set_report_stream(NULL);
 		return;
 	}
+	bool changes_array = false;
+	for (unsigned int i = 0; i < sizeof(array_commands) / sizeof(array_commands[0]); ++i) {
+		if (strcmp(cmd->cmds[0], array_commands[i]) == 0) {
+			changes_array = true;
+		}
+	}
+
+	/*
+	 * commands that can reuse a destination matrix only take the array exclusively when they can't,
+	 * spilled and preloaded matrices can only be read in while the array is held exclusively
+	 */
+	if (!changes_array) {
+		pthread_rwlock_rdlock(&mats_lock);
+		changes_array = names_spilled_matrix(cmd, mats, num_mats)
+			|| names_preload(cmd, mats, num_mats)
+			|| !execute_command(cmd, mats, num_mats, out, false);
+		pthread_rwlock_unlock(&mats_lock);
+	}
+	if (changes_array) {
+		pthread_rwlock_wrlock(&mats_lock);
+		next_command_epoch();
+		if (preload_named_matrices(cmd, mats, num_mats, out) && page_in_named_matrices(cmd, mats, num_mats, out)) {
+			execute_command(cmd, mats, num_mats, out, true);
+		}
+		pthread_rwlock_unlock(&mats_lock);
+	}
+	set_report_stream(NULL);
+	fflush(out);
+}
+
+  	/* 
+	 * PURPOSE: parses and calls the command entered by the user, the caller holds mats_lock
+	 * INPUT: 
+	 *	cmd - the user's input
+	 *	mats - the list of matrices
+	 *	num_mats - the number of matrices in the list
+	 *	out - the stream the results of the command are printed to
+	 *	exclusive - true if the caller holds mats_lock for writing
+	 * RETURN:
+	 *  True - if the command has been run
+	 *  False - if the command has to add to the array but exclusive is false, nothing has been done
+	 */
+bool execute_command (Commands_t* cmd, Matrix_t** mats, unsigned int num_mats, FILE* out, bool exclusive) {
 
 	/*Parsing and calling of commands*/
 	if (strncmp(cmd->cmds[0],"display",strlen("display") + 1) == 0
@@ -104,59 +228,221 @@ void run_commands (Commands_t* cmd, Matrix_t** mats, unsigned int num_mats) {
 			/*find the requested matrix*/
 			int idx = find_matrix_given_name(mats,num_mats,cmd->cmds[1]);
 			if (idx >= 0) {
-				display_matrix (mats[idx]);
+				lock_matrices(&mats[idx], 1, NULL);
+				display_matrix (mats[idx], out);
+				unlock_matrices(&mats[idx], 1);
 			}
 			else {
-				printf("Matrix (%s) doesn't exist\n", cmd->cmds[1]);
-				return;
+				fprintf(out, "Matrix (%s) doesn't exist\n", cmd->cmds[1]);
+				return true;
 			}
 	}
-	else if (strncmp(cmd->cmds[0],"add",strlen("add") + 1) == 0
-		&& cmd->num_cmds == 4) {
+	else if ((strncmp(cmd->cmds[0],"add",strlen("add") + 1) == 0 && cmd->num_cmds == 4)
+		|| (strncmp(cmd->cmds[0],"addi",strlen("addi") + 1) == 0 && cmd->num_cmds == 3)) {
+			/* addi a b is add a b a */
+			const char* dest_name = cmd->num_cmds == 4 ? cmd->cmds[3] : cmd->cmds[1];
 			int mat1_idx = find_matrix_given_name(mats,num_mats,cmd->cmds[1]);
 			int mat2_idx = find_matrix_given_name(mats,num_mats,cmd->cmds[2]);
 			if (mat1_idx >= 0 && mat2_idx >= 0) {
-				Matrix_t* c = NULL;
-				if( !create_matrix (&c,cmd->cmds[3], mats[mat1_idx]->rows, 
-						mats[mat1_idx]->cols)) {
-					printf("Failure to create the result Matrix (%s)\n", cmd->cmds[3]);
-					return;
+				Matrix_t* a = mats[mat1_idx];
+				Matrix_t* b = mats[mat2_idx];
+				if (a->rows != b->rows || a->cols != b->cols) {
+					fprintf(out, "Failure to add %s with %s, their sizes differ\n", a->name, b->name);
+					return true;
+				}
+
+				/* add into an existing matrix of the right size without allocating */
+				Matrix_t* c = reusable_destination(mats, num_mats, dest_name, a->rows, a->cols);
+				if (c) {
+					Matrix_t* operands[] = {a, b, c};
+					lock_matrices(operands, 3, c);
+					const bool added = add_matrices(a, b, c);
+					unlock_matrices(operands, 3);
+					if (!added) {
+						fprintf(out, "Failure to add %s with %s into %s\n", a->name, b->name, c->name);
+					}
+					return true;
+				}
+				if (!exclusive) {
+					return false;
+				}
+
+				if( !create_matrix (&c,dest_name, a->rows, a->cols)) {
+					fprintf(out, "Failure to create the result Matrix (%s)\n", dest_name);
+					return true;
 				}
 			
-				if ( add_matrix_to_array(mats,c, num_mats) == 99 ){
-					printf("Failed to add the result Matrix to the mats array.\n");
-					return;
-				} //TODO ERROR CHECK NEEDED
+				if (! add_matrices(a, b,c) ) {
+					fprintf(out, "Failure to add %s with %s into %s\n", a->name, b->name,c->name);
+					destroy_matrix(&c);
+					return true;	
+				}
 
+				if ( add_matrix_to_array(mats,c, num_mats) == MATRIX_ARRAY_ERROR ){
+					fprintf(out, "Failed to add the result Matrix to the mats array.\n");
+					destroy_matrix(&c);
+					return true;
+				}
+			}
+			else {
+				fprintf(out, "Add Failed\n");
+				return true;
+			}
+	}
+	else if ((strncmp(cmd->cmds[0],"addn",strlen("addn") + 1) == 0
+		|| strncmp(cmd->cmds[0],"maxn",strlen("maxn") + 1) == 0
+		|| strncmp(cmd->cmds[0],"minn",strlen("minn") + 1) == 0)
+		&& cmd->num_cmds >= 3 && strlen(cmd->cmds[1]) + 1 <= MATRIX_NAME_LEN) {
+			const Reduce_Op_t op = cmd->cmds[0][0] == 'a' ? REDUCE_ADD
+				: cmd->cmds[0][1] == 'a' ? REDUCE_MAX : REDUCE_MIN;
+			const unsigned int n = cmd->num_cmds - 2;
+			/* one spare slot for the result */
+			Matrix_t* operands[n + 1];
+			if (!find_named_matrices(cmd, 2, n, mats, num_mats, operands, out)) {
+				return true;
+			}
+			for (unsigned int k = 1; k < n; ++k) {
+				if (operands[k]->rows != operands[0]->rows || operands[k]->cols != operands[0]->cols) {
+					fprintf(out, "Failure to combine %s with %s, their sizes differ\n", operands[0]->name, operands[k]->name);
+					return true;
+				}
+			}
 
-				if (! add_matrices(mats[mat1_idx], mats[mat2_idx],c) ) {
-					printf("Failure to add %s with %s into %s\n", mats[mat1_idx]->name, mats[mat2_idx]->name,c->name);
-					return;	
+			Matrix_t* result = reusable_destination(mats, num_mats, cmd->cmds[1], operands[0]->rows, operands[0]->cols);
+			if (result) {
+				operands[n] = result;
+				lock_matrices(operands, n + 1, result);
+				const bool combined = reduce_matrices(operands, n, op, result);
+				unlock_matrices(operands, n + 1);
+				if (!combined) {
+					fprintf(out, "Failure to combine the matricies into %s\n", result->name);
 				}
+				return true;
+			}
+			if (!exclusive) {
+				return false;
+			}
+
+			if (!create_matrix(&result, cmd->cmds[1], operands[0]->rows, operands[0]->cols)) {
+				fprintf(out, "Failure to create the result Matrix (%s)\n", cmd->cmds[1]);
+				return true;
+			}
+			if (!reduce_matrices(operands, n, op, result)) {
+				fprintf(out, "Failure to combine the matricies into %s\n", result->name);
+				destroy_matrix(&result);
+				return true;
+			}
+			if (add_matrix_to_array(mats, result, num_mats) == MATRIX_ARRAY_ERROR) {
+				fprintf(out, "Failed to add the result Matrix to the mats array.\n");
+				destroy_matrix(&result);
+				return true;
+			}
+	}
+	else if (strncmp(cmd->cmds[0],"sum_all",strlen("sum_all") + 1) == 0
+		&& cmd->num_cmds >= 2) {
+			const unsigned int n = cmd->num_cmds - 1;
+			Matrix_t* operands[n];
+			if (!find_named_matrices(cmd, 1, n, mats, num_mats, operands, out)) {
+				return true;
+			}
+			unsigned long long sum = 0;
+			lock_matrices(operands, n, NULL);
+			const bool summed = sum_all_matrices(operands, n, &sum);
+			unlock_matrices(operands, n);
+			if (!summed) {
+				fprintf(out, "Sum Failed\n");
+				return true;
+			}
+			fprintf(out, "Sum of %u Matricies is %llu\n", n, sum);
+	}
+	else if ((strncmp(cmd->cmds[0],"addrow",strlen("addrow") + 1) == 0
+		|| strncmp(cmd->cmds[0],"addcol",strlen("addcol") + 1) == 0)
+		&& cmd->num_cmds == 4 && strlen(cmd->cmds[3]) + 1 <= MATRIX_NAME_LEN) {
+			Matrix_t* operands[3];
+			if (!find_named_matrices(cmd, 1, 2, mats, num_mats, operands, out)) {
+				return true;
+			}
+			Matrix_t* a = operands[0];
+			Matrix_t* vector = operands[1];
+			const bool row_vector = cmd->cmds[0][3] == 'r';
+			if ((row_vector && (vector->rows != 1 || vector->cols != a->cols))
+				|| (!row_vector && (vector->cols != 1 || vector->rows != a->rows))) {
+				fprintf(out, "Matrix (%s) must be a %s vector as long as the %s of %s\n", vector->name,
+					row_vector ? "row" : "column", row_vector ? "columns" : "rows", a->name);
+				return true;
+			}
+
+			Matrix_t* result = reusable_destination(mats, num_mats, cmd->cmds[3], a->rows, a->cols);
+			if (result) {
+				operands[2] = result;
+				lock_matrices(operands, 3, result);
+				const bool added = broadcast_add_matrix(a, vector, result);
+				unlock_matrices(operands, 3);
+				if (!added) {
+					fprintf(out, "Failure to add %s to %s into %s\n", vector->name, a->name, result->name);
+				}
+				return true;
+			}
+			if (!exclusive) {
+				return false;
+			}
+
+			if (!create_matrix(&result, cmd->cmds[3], a->rows, a->cols)) {
+				fprintf(out, "Failure to create the result Matrix (%s)\n", cmd->cmds[3]);
+				return true;
+			}
+			if (!broadcast_add_matrix(a, vector, result)) {
+				fprintf(out, "Failure to add %s to %s into %s\n", vector->name, a->name, result->name);
+				destroy_matrix(&result);
+				return true;
+			}
+			if (add_matrix_to_array(mats, result, num_mats) == MATRIX_ARRAY_ERROR) {
+				fprintf(out, "Failed to add the result Matrix to the mats array.\n");
+				destroy_matrix(&result);
+				return true;
 			}
 	}
 	else if (strncmp(cmd->cmds[0],"duplicate",strlen("duplicate") + 1) == 0
-		&& cmd->num_cmds == 3 && strlen(cmd->cmds[1]) + 1 <= MATRIX_NAME_LEN) {
+		&& cmd->num_cmds == 3 && strlen(cmd->cmds[2]) + 1 <= MATRIX_NAME_LEN) {
 		int mat1_idx = find_matrix_given_name(mats,num_mats,cmd->cmds[1]);
 		if (mat1_idx >= 0 ) {
-				Matrix_t* dup_mat = NULL;
-				if( !create_matrix (&dup_mat,cmd->cmds[2], mats[mat1_idx]->rows, 
-						mats[mat1_idx]->cols)) {
-					return;
+				Matrix_t* src = mats[mat1_idx];
+				Matrix_t* dup_mat = reusable_destination(mats, num_mats, cmd->cmds[2], src->rows, src->cols);
+				if (dup_mat) {
+					Matrix_t* operands[] = {src, dup_mat};
+					lock_matrices(operands, 2, dup_mat);
+					const bool copied = duplicate_matrix (src, dup_mat);
+					unlock_matrices(operands, 2);
+					if (!copied) {
+						fprintf(out, "Failed to duplicate matrix.\n");
+						return true;
+					}
+					fprintf(out, "Duplication of %s into %s finished\n", src->name, cmd->cmds[2]);
+					return true;
 				}
-				if( !duplicate_matrix (mats[mat1_idx], dup_mat) ){
-					printf("Failed to duplicate matrix.\n");
-					return;
-				}//TODO ERROR CHECK NEEDED
-				if( add_matrix_to_array(mats,dup_mat,num_mats) == 99 ){
-					printf("Failed to add matrix to matrix array.\n");
-					return;
-				} //TODO ERROR CHECK NEEDED
-				printf ("Duplication of %s into %s finished\n", mats[mat1_idx]->name, cmd->cmds[2]);
+				if (!exclusive) {
+					return false;
+				}
+
+				if( !create_matrix (&dup_mat,cmd->cmds[2], src->rows, 
+						src->cols)) {
+					return true;
+				}
+				if( !duplicate_matrix (src, dup_mat) ){
+					fprintf(out, "Failed to duplicate matrix.\n");
+					destroy_matrix(&dup_mat);
+					return true;
+				}
+				if( add_matrix_to_array(mats,dup_mat,num_mats) == MATRIX_ARRAY_ERROR ){
+					fprintf(out, "Failed to add matrix to matrix array.\n");
+					destroy_matrix(&dup_mat);
+					return true;
+				}
+				fprintf(out, "Duplication of %s into %s finished\n", src->name, cmd->cmds[2]);
 		}
 		else {
-			printf("Duplication Failed\n");
-			return;
+			fprintf(out, "Duplication Failed\n");
+			return true;
 		}
 	}
 	else if (strncmp(cmd->cmds[0],"equal",strlen("equal") + 1) == 0
@@ -164,32 +450,99 @@ void run_commands (Commands_t* cmd, Matrix_t** mats, unsigned int num_mats) {
 			int mat1_idx = find_matrix_given_name(mats,num_mats,cmd->cmds[1]);
 			int mat2_idx = find_matrix_given_name(mats,num_mats,cmd->cmds[2]);
 			if (mat1_idx >= 0 && mat2_idx >= 0) {
-				if ( equal_matrices(mats[mat1_idx],mats[mat2_idx]) ) {
-					printf("SAME DATA IN BOTH\n");
+				Matrix_t* operands[] = {mats[mat1_idx], mats[mat2_idx]};
+				lock_matrices(operands, 2, NULL);
+				const bool same = equal_matrices(mats[mat1_idx],mats[mat2_idx]);
+				unlock_matrices(operands, 2);
+				if ( same ) {
+					fprintf(out, "SAME DATA IN BOTH\n");
 				}
 				else {
-					printf("DIFFERENT DATA IN BOTH\n");
+					fprintf(out, "DIFFERENT DATA IN BOTH\n");
 				}
 			}
 			else {
-				printf("Equal Failed\n");
-				return;
+				fprintf(out, "Equal Failed\n");
+				return true;
 			}
 	}
+	else if (strncmp(cmd->cmds[0],"sum",strlen("sum") + 1) == 0
+		&& cmd->num_cmds == 2) {
+		int mat1_idx = find_matrix_given_name(mats,num_mats,cmd->cmds[1]);
+		if (mat1_idx >= 0) {
+			lock_matrices(&mats[mat1_idx], 1, NULL);
+			const unsigned long long sum = sum_matrix(mats[mat1_idx]);
+			unlock_matrices(&mats[mat1_idx], 1);
+			fprintf(out, "Sum of Matrix (%s) is %llu\n", mats[mat1_idx]->name, sum);
+		}
+		else {
+			fprintf(out, "Sum Failed\n");
+			return true;
+		}
+	}
+	else if ((strncmp(cmd->cmds[0],"stats",strlen("stats") + 1) == 0
+		|| strncmp(cmd->cmds[0],"min",strlen("min") + 1) == 0
+		|| strncmp(cmd->cmds[0],"max",strlen("max") + 1) == 0
+		|| strncmp(cmd->cmds[0],"mean",strlen("mean") + 1) == 0
+		|| strncmp(cmd->cmds[0],"hist",strlen("hist") + 1) == 0)
+		&& cmd->num_cmds == 2) {
+		int mat1_idx = find_matrix_given_name(mats,num_mats,cmd->cmds[1]);
+		if (mat1_idx < 0) {
+			fprintf(out, "Matrix (%s) doesn't exist\n", cmd->cmds[1]);
+			return true;
+		}
+		Matrix_Stats_t stats;
+		lock_matrices(&mats[mat1_idx], 1, NULL);
+		const bool computed = matrix_stats(mats[mat1_idx], &stats);
+		const unsigned long long count = (unsigned long long)mats[mat1_idx]->rows * mats[mat1_idx]->cols;
+		unlock_matrices(&mats[mat1_idx], 1);
+		if (!computed) {
+			fprintf(out, "Stats Failed\n");
+			return true;
+		}
+		const double mean = count ? (double)stats.sum / count : 0.0;
+
+		if (cmd->cmds[0][0] == 's') {
+			fprintf(out, "Matrix (%s): sum %llu min %u max %u mean %.3f\n", cmd->cmds[1],
+				stats.sum, stats.min, stats.max, mean);
+		}
+		else if (strcmp(cmd->cmds[0], "min") == 0) {
+			fprintf(out, "Min of Matrix (%s) is %u\n", cmd->cmds[1], stats.min);
+		}
+		else if (strcmp(cmd->cmds[0], "max") == 0) {
+			fprintf(out, "Max of Matrix (%s) is %u\n", cmd->cmds[1], stats.max);
+		}
+		else if (strcmp(cmd->cmds[0], "mean") == 0) {
+			fprintf(out, "Mean of Matrix (%s) is %.3f\n", cmd->cmds[1], mean);
+		}
+		else {
+			fprintf(out, "Histogram of Matrix (%s):\n", cmd->cmds[1]);
+			for (unsigned int bin = 0; bin < MATRIX_HIST_BINS; ++bin) {
+				if (stats.hist[bin]) {
+					const unsigned int low = bin ? 1u << (bin - 1) : 0;
+					const unsigned int high = bin ? (unsigned int)((2ull << (bin - 1)) - 1) : 0;
+					fprintf(out, "[%u,%u] %llu\n", low, high, stats.hist[bin]);
+				}
+			}
+		}
+	}
 	else if (strncmp(cmd->cmds[0],"shift",strlen("shift") + 1) == 0
 		&& cmd->num_cmds == 4) {
 		int mat1_idx = find_matrix_given_name(mats,num_mats,cmd->cmds[1]);
 		const int shift_value = atoi(cmd->cmds[3]);
 		if (mat1_idx >= 0 ) {
-			if( !bitwise_shift_matrix(mats[mat1_idx],cmd->cmds[2][0], shift_value) ){
-				printf("Bit shift failed\n");
-				return;
-			} //TODO ERROR CHECK NEEDED
-			printf("Matrix (%s) has been shifted by %d\n", mats[mat1_idx]->name, shift_value);
+			lock_matrices(&mats[mat1_idx], 1, mats[mat1_idx]);
+			const bool shifted = bitwise_shift_matrix(mats[mat1_idx],cmd->cmds[2][0], shift_value);
+			unlock_matrices(&mats[mat1_idx], 1);
+			if( !shifted ){
+				fprintf(out, "Bit shift failed\n");
+				return true;
+			}
+			fprintf(out, "Matrix (%s) has been shifted by %d\n", mats[mat1_idx]->name, shift_value);
 		}
 		else {
-			printf("Matrix shift failed\n");
-			return;
+			fprintf(out, "Matrix shift failed\n");
+			return true;
 		}
 
 	}
@@ -197,59 +550,160 @@ void run_commands (Commands_t* cmd, Matrix_t** mats, unsigned int num_mats) {
 		&& cmd->num_cmds == 2) {
 		Matrix_t* new_matrix = NULL;
 		if(! read_matrix(cmd->cmds[1],&new_matrix)) {
-			printf("Read Failed\n");
-			return;
+			fprintf(out, "Read Failed\n");
+			return true;
 		}	
 		
-		if( add_matrix_to_array(mats,new_matrix, num_mats) == 99 ){
-			printf("Failed to add matrix to matrix array.\n");
-			return; //TODO ERROR CHECK NEEDED
+		if( add_matrix_to_array(mats,new_matrix, num_mats) == MATRIX_ARRAY_ERROR ){
+			fprintf(out, "Failed to add matrix to matrix array.\n");
+			destroy_matrix(&new_matrix);
+			return true;
 		}
-		printf("Matrix (%s) is read from the filesystem\n", cmd->cmds[1]);	
+		fprintf(out, "Matrix (%s) is read from the filesystem\n", cmd->cmds[1]);	
+	}
+	else if (strncmp(cmd->cmds[0],"readall",strlen("readall") + 1) == 0
+		&& cmd->num_cmds == 2) {
+		glob_t found;
+		unsigned int num_files = 0;
+		const char** files = find_matrix_files(cmd->cmds[1], &found, &num_files);
+		if (!files) {
+			fprintf(out, "No matrix files found in %s\n", cmd->cmds[1]);
+			return true;
+		}
+
+		struct timespec start, end;
+		clock_gettime(CLOCK_MONOTONIC, &start);
+		unsigned long long bytes = 0;
+		const unsigned int num_read = read_matrices(files, num_files, mats, num_mats, &bytes);
+		clock_gettime(CLOCK_MONOTONIC, &end);
+
+		const double seconds = (end.tv_sec - start.tv_sec) + (end.tv_nsec - start.tv_nsec) / 1e9;
+		const double megabytes = bytes / (1024.0 * 1024.0);
+		fprintf(out, "Read %u of %u matrix files, %.1f MB in %.3f seconds (%.1f MB/s)\n", num_read, num_files,
+			megabytes, seconds, seconds > 0 ? megabytes / seconds : 0.0);
+		free(files);
+		globfree(&found);
 	}
 	else if (strncmp(cmd->cmds[0],"write",strlen("write") + 1) == 0
 		&& cmd->num_cmds == 2) {
 		int mat1_idx = find_matrix_given_name(mats,num_mats,cmd->cmds[1]);
-		if(! write_matrix(mats[mat1_idx]->name,mats[mat1_idx])) {
-			printf("Write Failed\n");
-			return;
+		if (mat1_idx < 0) {
+			fprintf(out, "Write Failed\n");
+			return true;
+		}
+		lock_matrices(&mats[mat1_idx], 1, NULL);
+		const bool wrote = write_matrix(mats[mat1_idx]->name,mats[mat1_idx]);
+		unlock_matrices(&mats[mat1_idx], 1);
+		if(! wrote) {
+			fprintf(out, "Write Failed\n");
+			return true;
 		}
 		else {
-			printf("Matrix (%s) is wrote out to the filesystem\n", mats[mat1_idx]->name);
+			fprintf(out, "Matrix (%s) is wrote out to the filesystem\n", mats[mat1_idx]->name);
 		}
 	}
 	else if (strncmp(cmd->cmds[0], "create", strlen("create") + 1) == 0
-		&& strlen(cmd->cmds[1]) + 1 <= MATRIX_NAME_LEN && cmd->num_cmds == 4) {
+		&& cmd->num_cmds == 4 && strlen(cmd->cmds[1]) + 1 <= MATRIX_NAME_LEN) {
 		Matrix_t* new_mat = NULL;
 		const unsigned int rows = atoi(cmd->cmds[2]);
 		const unsigned int cols = atoi(cmd->cmds[3]);
 
 		if( !create_matrix(&new_mat,cmd->cmds[1],rows, cols) ){
-			printf("Failed to create matrix.\n");
-			return;
-		} //TODO ERROR CHECK NEEDED
-		if( add_matrix_to_array(mats,new_mat,num_mats) == 99 ){
-			printf("Failed to add matrix to array.\n");
-			return;
-		} // TODO ERROR CHECK NEEDED
-		printf("Created Matrix (%s,%u,%u)\n", new_mat->name, new_mat->rows, new_mat->cols);
+			fprintf(out, "Failed to create matrix.\n");
+			return true;
+		}
+		if( add_matrix_to_array(mats,new_mat,num_mats) == MATRIX_ARRAY_ERROR ){
+			fprintf(out, "Failed to add matrix to array.\n");
+			destroy_matrix(&new_mat);
+			return true;
+		}
+		fprintf(out, "Created Matrix (%s,%u,%u)\n", new_mat->name, new_mat->rows, new_mat->cols);
 	}
 	else if (strncmp(cmd->cmds[0], "random", strlen("random") + 1) == 0
 		&& cmd->num_cmds == 4) {
 		int mat1_idx = find_matrix_given_name(mats,num_mats,cmd->cmds[1]);
 		const unsigned int start_range = atoi(cmd->cmds[2]);
 		const unsigned int end_range = atoi(cmd->cmds[3]);
-		if( !random_matrix(mats[mat1_idx],start_range, end_range) ){
-			printf("Failed to randmize matrix.\n");
-			return;
-		} //TODO ERROR CHECK NEEDED
+		if (mat1_idx < 0) {
+			fprintf(out, "Failed to randmize matrix.\n");
+			return true;
+		}
+		lock_matrices(&mats[mat1_idx], 1, mats[mat1_idx]);
+		const bool randomized = random_matrix(mats[mat1_idx],start_range, end_range);
+		unlock_matrices(&mats[mat1_idx], 1);
+		if( !randomized ){
+			fprintf(out, "Failed to randmize matrix.\n");
+			return true;
+		}
 
-		printf("Matrix (%s) is randomized between %u %u\n", mats[mat1_idx]->name, start_range, end_range);
+		fprintf(out, "Matrix (%s) is randomized between %u %u\n", mats[mat1_idx]->name, start_range, end_range);
+	}
+	else if (strncmp(cmd->cmds[0], "slice", strlen("slice") + 1) == 0
+		&& cmd->num_cmds == 7) {
+		int mat1_idx = find_matrix_given_name(mats,num_mats,cmd->cmds[1]);
+		if (mat1_idx < 0) {
+			fprintf(out, "Matrix (%s) doesn't exist\n", cmd->cmds[1]);
+			return true;
+		}
+		Matrix_t* view = NULL;
+		if (!slice_matrix(&view, cmd->cmds[6], mats[mat1_idx], atoi(cmd->cmds[2]), atoi(cmd->cmds[3]),
+				atoi(cmd->cmds[4]), atoi(cmd->cmds[5]))) {
+			fprintf(out, "Failed to slice matrix.\n");
+			return true;
+		}
+		if (add_matrix_to_array(mats,view,num_mats) == MATRIX_ARRAY_ERROR) {
+			fprintf(out, "Failed to add matrix to array.\n");
+			destroy_matrix(&view);
+			return true;
+		}
+		fprintf(out, "Sliced Matrix (%s,%u,%u) out of (%s)\n", view->name, view->rows, view->cols, cmd->cmds[1]);
+	}
+	else if (strncmp(cmd->cmds[0], "mem", strlen("mem") + 1) == 0
+		&& cmd->num_cmds <= 2) {
+		if (cmd->num_cmds == 2) {
+			size_t budget = 0;
+			if (!parse_megabytes(cmd->cmds[1], &budget)) {
+				fprintf(out, "Bad memory budget (%s), give a number of megabytes\n", cmd->cmds[1]);
+				return true;
+			}
+			set_memory_budget(budget);
+		}
+		Memory_Usage_t usage;
+		memory_usage(&usage);
+		if (usage.budget) {
+			fprintf(out, "Matrix memory: %zu of %zu MB in use\n", usage.in_use >> 20, usage.budget >> 20);
+		}
+		else {
+			fprintf(out, "Matrix memory: %zu MB in use, no budget\n", usage.in_use >> 20);
+		}
+		fprintf(out, "%u matrices in memory, %u spilled (%zu MB), scratch file %zu MB\n", usage.resident,
+			usage.spilled, usage.spilled_bytes >> 20, usage.scratch_bytes >> 20);
+	}
+	else if (strncmp(cmd->cmds[0], "save_workspace", strlen("save_workspace") + 1) == 0
+		&& cmd->num_cmds == 2) {
+		lock_matrices(mats, num_mats, NULL);
+		const bool saved = save_workspace(cmd->cmds[1], mats, num_mats);
+		unlock_matrices(mats, num_mats);
+		if (!saved) {
+			fprintf(out, "Failed to save the workspace.\n");
+			return true;
+		}
+		fprintf(out, "Workspace is saved to (%s)\n", cmd->cmds[1]);
+	}
+	else if (strncmp(cmd->cmds[0], "load_workspace", strlen("load_workspace") + 1) == 0
+		&& cmd->num_cmds == 2) {
+		const int loaded = load_workspace(cmd->cmds[1], mats, num_mats);
+		if (loaded < 0) {
+			fprintf(out, "Failed to load the workspace.\n");
+			return true;
+		}
+		fprintf(out, "%d matrices are loaded from (%s)\n", loaded, cmd->cmds[1]);
 	}
 	else {
-		printf("Not a command in this application\n");
+		fprintf(out, "Not a command in this application\n");
 	}
 
+	return true;
 }
 
    	/* 
@@ -260,22 +714,376 @@ void run_commands (Commands_t* cmd, Matrix_t** mats, unsigned int num_mats) {
 	 *  target - the name of the matrix that is being looked for
 	 * RETURN:
 	 *  i -  the index of the matrix found
-	 *  99 - if the given matrix name is not found
+	 *  -1 - if the given matrix name is not found or the inputs are NULL
 	 */
 unsigned int find_matrix_given_name (Matrix_t** mats, unsigned int num_mats, const char* target) {
-	if( !target || !(*mats) ){
-		printf("Null matrix name given or null list of matricies.\n");
-		return 99;
-	} //TODO ERROR CHECK INCOMING PARAMETERS
+	if( !target || !mats ){
+		report("Null matrix name given or null list of matricies.\n");
+		return -1;
+	}
 
 	for (int i = 0; i < num_mats; ++i) {
-		if (strncmp(mats[i]->name,target,strlen(mats[i]->name)) == 0) {
+		if (mats[i] && strncmp(mats[i]->name,target,MATRIX_NAME_LEN) == 0) {
+			touch_matrix(mats[i]);
 			return i;
 		}
 	}
 	return -1;
 }
 
+   	/* 
+	 * PURPOSE: checks if any word of the command names a matrix that has been spilled to disk
+	 * INPUT: 
+	 *	cmd - the user's input
+	 *	mats - the list of matrices
+	 *	num_mats - the number of matrices in the list
+	 * RETURN:
+	 *  True - if a named matrix has to be read back in before the command can run
+	 *  False - if every named matrix is in memory
+	 */
+bool names_spilled_matrix (Commands_t* cmd, Matrix_t** mats, unsigned int num_mats) {
+
+	for (unsigned int i = 1; i < cmd->num_cmds; ++i) {
+		int idx = find_matrix_given_name(mats, num_mats, cmd->cmds[i]);
+		if (idx >= 0 && mats[idx]->spilled) {
+			return true;
+		}
+	}
+	return false;
+}
+
+   	/* 
+	 * PURPOSE: checks if the command names a preloaded matrix that has not been read yet
+	 * INPUT: 
+	 *	cmd - the user's input
+	 *	mats - the list of matrices
+	 *	num_mats - the number of matrices in the list
+	 * RETURN:
+	 *  True - if one of the arguments is the name of a preload that still has to be read
+	 *  False - if none is
+	 */
+bool names_preload (Commands_t* cmd, Matrix_t** mats, unsigned int num_mats) {
+
+	for (unsigned int i = 1; i < cmd->num_cmds; ++i) {
+		for (unsigned int p = 0; p < num_preloads; ++p) {
+			if (!preloads[p].done && strncmp(preloads[p].name, cmd->cmds[i], MATRIX_NAME_LEN) == 0
+				&& (int)find_matrix_given_name(mats, num_mats, cmd->cmds[i]) < 0) {
+				return true;
+			}
+		}
+	}
+	return false;
+}
+
+   	/* 
+	 * PURPOSE: reads the preloaded matrices the command names the first time they are used,
+	 *  the caller holds mats_lock exclusively
+	 * INPUT: 
+	 *	cmd - the user's input
+	 *	mats - the list of matrices
+	 *	num_mats - the number of matrices in the list
+	 *	out - the stream errors are printed to
+	 * RETURN:
+	 *  True - if every preload the command names has been read
+	 *  False - if one could not be read
+	 */
+bool preload_named_matrices (Commands_t* cmd, Matrix_t** mats, unsigned int num_mats, FILE* out) {
+
+	for (unsigned int i = 1; i < cmd->num_cmds; ++i) {
+		for (unsigned int p = 0; p < num_preloads; ++p) {
+			if (preloads[p].done || strncmp(preloads[p].name, cmd->cmds[i], MATRIX_NAME_LEN) != 0) {
+				continue;
+			}
+			/* a matrix made with the same name before first use takes the place of the file */
+			preloads[p].done = true;
+			if ((int)find_matrix_given_name(mats, num_mats, preloads[p].name) >= 0) {
+				continue;
+			}
+			Matrix_t* new_matrix = NULL;
+			if (!read_matrix(preloads[p].path, &new_matrix)) {
+				fprintf(out, "Failed to preload %s\n", preloads[p].path);
+				return false;
+			}
+			/* the command uses the name of the file, whatever the matrix was called when it was written */
+			memcpy(new_matrix->name, preloads[p].name, MATRIX_NAME_LEN);
+			if (add_matrix_to_array(mats, new_matrix, num_mats) == MATRIX_ARRAY_ERROR) {
+				fprintf(out, "Failed to add matrix (%s) to matrix array.\n", new_matrix->name);
+				destroy_matrix(&new_matrix);
+				return false;
+			}
+		}
+	}
+	return true;
+}
+
+   	/* 
+	 * PURPOSE: reads every matrix the command names back in from disk, the caller holds mats_lock exclusively
+	 * INPUT: 
+	 *	cmd - the user's input
+	 *	mats - the list of matrices
+	 *	num_mats - the number of matrices in the list
+	 *	out - the stream errors are printed to
+	 * RETURN:
+	 *  True - if every named matrix is in memory
+	 *  False - if one could not be read back in
+	 */
+bool page_in_named_matrices (Commands_t* cmd, Matrix_t** mats, unsigned int num_mats, FILE* out) {
+
+	for (unsigned int i = 1; i < cmd->num_cmds; ++i) {
+		int idx = find_matrix_given_name(mats, num_mats, cmd->cmds[i]);
+		if (idx >= 0 && !page_in_matrix(mats[idx])) {
+			fprintf(out, "Matrix (%s) could not be read back in, raise the budget with mem\n", mats[idx]->name);
+			return false;
+		}
+	}
+	return true;
+}
+
+   	/* 
+	 * PURPOSE: looks up the matricies named by a run of the command's arguments
+	 * INPUT: 
+	 *	cmd - the user's input
+	 *	first - the index of the first argument that names a matrix
+	 *	count - the number of arguments that name matricies
+	 *	mats - the list of matrices
+	 *	num_mats - the number of matrices in the list
+	 *	found - where the matricies are stored, in the order they are named
+	 *	out - the stream a missing name is reported to
+	 * RETURN:
+	 *  True - if every named matrix exists
+	 *  False - if one of them doesn't
+	 */
+bool find_named_matrices (Commands_t* cmd, unsigned int first, unsigned int count, Matrix_t** mats, unsigned int num_mats,
+			Matrix_t** found, FILE* out) {
+
+	for (unsigned int i = first; i < first + count && i < cmd->num_cmds; ++i) {
+		int idx = find_matrix_given_name(mats, num_mats, cmd->cmds[i]);
+		if (idx < 0) {
+			fprintf(out, "Matrix (%s) doesn't exist\n", cmd->cmds[i]);
+			return false;
+		}
+		found[i - first] = mats[idx];
+	}
+	return true;
+}
+
+   	/* 
+	 * PURPOSE: lists the regular files in a directory or matching a glob pattern
+	 * INPUT: 
+	 *	target - a directory or a glob pattern such as "data/m*"
+	 *	found - the glob results the list points into, free them with globfree once done with the list
+	 *	num_files - set to the number of files in the list
+	 * RETURN:
+	 *  the list of files, free it with free
+	 *  NULL - if no files were found
+	 */
+const char** find_matrix_files (const char* target, glob_t* found, unsigned int* num_files) {
+
+	char pattern[PATH_MAX];
+	struct stat st;
+	if (stat(target, &st) == 0 && S_ISDIR(st.st_mode)) {
+		if (snprintf(pattern, sizeof(pattern), "%s/*", target) >= (int)sizeof(pattern)) {
+			return NULL;
+		}
+	}
+	else if (snprintf(pattern, sizeof(pattern), "%s", target) >= (int)sizeof(pattern)) {
+		return NULL;
+	}
+
+	if (glob(pattern, 0, NULL, found)) {
+		return NULL;
+	}
+	const char** files = malloc(found->gl_pathc * sizeof(char*));
+	if (!files) {
+		globfree(found);
+		return NULL;
+	}
+	*num_files = 0;
+	for (size_t i = 0; i < found->gl_pathc; ++i) {
+		if (stat(found->gl_pathv[i], &st) == 0 && S_ISREG(st.st_mode)) {
+			files[(*num_files)++] = found->gl_pathv[i];
+		}
+	}
+	if (*num_files == 0) {
+		free(files);
+		globfree(found);
+		return NULL;
+	}
+	return files;
+}
+
+   	/* 
+	 * PURPOSE: finds a matrix that a result can be written into without allocating
+	 * INPUT: 
+	 *	mats - the list of matrices
+	 *	num_mats - the number of matrices in the list
+	 *	name - the name of the result matrix
+	 *	rows - the number of rows of the result
+	 *	cols - the number of cols of the result
+	 * RETURN:
+	 *  the existing matrix with the given name if it has the same size as the result
+	 *  NULL - if there is no such matrix
+	 */
+Matrix_t* reusable_destination (Matrix_t** mats, unsigned int num_mats, const char* name,
+			unsigned int rows, unsigned int cols) {
+
+	int idx = find_matrix_given_name(mats, num_mats, name);
+	if (idx < 0 || mats[idx]->rows != rows || mats[idx]->cols != cols) {
+		return NULL;
+	}
+	return mats[idx];
+}
+
+   	/* 
+	 * PURPOSE: reads startup settings from a file, one "key value" per line and # starts a comment,
+	 *  the keys are socket, memory, scratch, temp_mat (on or off) and preload
+	 * INPUT: 
+	 *	config_filename - the file to read
+	 *	startup - the settings that are changed
+	 * RETURN:
+	 *  True - if every line was understood
+	 *  False - if the file could not be read or has a bad line
+	 */
+bool read_config (const char* config_filename, Startup_t* startup) {
+
+	FILE* file = fopen(config_filename, "r");
+	if (!file) {
+		perror("FAILED TO OPEN THE CONFIG FILE");
+		return false;
+	}
+
+	char buffer[PATH_MAX + 32];
+	unsigned int line_number = 0;
+	bool understood = true;
+	while (understood && fgets(buffer, sizeof(buffer), file)) {
+		line_number++;
+		char* comment = strchr(buffer, '#');
+		if (comment) {
+			*comment = '\0';
+		}
+		char key[32];
+		char value[PATH_MAX];
+		int fields = sscanf(buffer, "%31s %4095s", key, value);
+		if (fields <= 0) {
+			continue;
+		}
+
+		if (fields != 2) {
+			understood = false;
+		}
+		else if (strcmp(key, "socket") == 0) {
+			free(startup->socket_path);
+			startup->socket_path = strdup(value);
+		}
+		else if (strcmp(key, "memory") == 0) {
+			size_t budget = 0;
+			understood = parse_megabytes(value, &budget);
+			if (understood) {
+				set_memory_budget(budget);
+			}
+		}
+		else if (strcmp(key, "scratch") == 0) {
+			understood = set_scratch_dir(value);
+		}
+		else if (strcmp(key, "temp_mat") == 0 && (strcmp(value, "on") == 0 || strcmp(value, "off") == 0)) {
+			startup->temp_mat = strcmp(value, "on") == 0;
+		}
+		else if (strcmp(key, "preload") == 0) {
+			understood = add_preload(value);
+		}
+		else {
+			understood = false;
+		}
+	}
+	if (!understood) {
+		printf("Bad setting on line %u of %s\n", line_number, config_filename);
+	}
+	fclose(file);
+	return understood;
+}
+
+   	/* 
+	 * PURPOSE: turns a memory budget given in megabytes into bytes
+	 * INPUT: 
+	 *	text - the number of megabytes, digits only
+	 *	bytes - set to the number of bytes
+	 * RETURN:
+	 *  True - if the budget is a number that fits in a size_t once made bytes
+	 *  False - if it is not a number or is too big
+	 */
+bool parse_megabytes (const char* text, size_t* bytes) {
+
+	char* end = NULL;
+	errno = 0;
+	const unsigned long long megabytes = strtoull(text, &end, 10);
+	/* strtoull skips spaces and takes a minus sign, so the first character has to be a digit */
+	if (!isdigit((unsigned char)text[0]) || *end != '\0' || errno == ERANGE || megabytes > SIZE_MAX >> 20) {
+		return false;
+	}
+	*bytes = (size_t)megabytes << 20;
+	return true;
+}
+
+   	/* 
+	 * PURPOSE: remembers a matrix file to read the first time a command names it, nothing is read now
+	 * INPUT: 
+	 *	path - the matrix file, the matrix is named after the last part of the path
+	 * RETURN:
+	 *  True - if the file will be preloaded
+	 *  False - if its name is too long or there are too many preloads
+	 */
+bool add_preload (const char* path) {
+
+	const char* name = strrchr(path, '/');
+	name = name ? name + 1 : path;
+	if (strlen(name) == 0 || strlen(name) + 1 > MATRIX_NAME_LEN) {
+		printf("Preload (%s) needs a file name of 1 to %u characters\n", path, MATRIX_NAME_LEN - 1);
+		return false;
+	}
+	if (num_preloads == MAX_PRELOADS) {
+		printf("Only %u matrix files can be preloaded\n", MAX_PRELOADS);
+		return false;
+	}
+	preloads[num_preloads].path = strdup(path);
+	if (!preloads[num_preloads].path) {
+		return false;
+	}
+	memcpy(preloads[num_preloads].name, name, strlen(name) + 1);
+	preloads[num_preloads].done = false;
+	num_preloads++;
+	return true;
+}
+
+   	/* 
+	 * PURPOSE: makes the 5 x 5 temp_mat of random numbers and writes it to the current directory
+	 * INPUT: 
+	 *	mats - the list of matrices
+	 *	num_mats - the number of matrices in the list
+	 * RETURN:
+	 *  True - if temp_mat is in the list, it is kept even if it could not be written
+	 *  False - if it could not be made
+	 */
+bool create_temp_mat (Matrix_t** mats, unsigned int num_mats) {
+
+	Matrix_t *temp = NULL;
+	if (!create_matrix(&temp, "temp_mat", 5, 5) || !random_matrix(temp, 10, 15)) {
+		fprintf(stderr, "PROGRAM FAILED TO CREATE TMP MATRIX\n");
+		destroy_matrix(&temp);
+		return false;
+	}
+	if (add_matrix_to_array(mats, temp, num_mats) == MATRIX_ARRAY_ERROR) {
+		fprintf(stderr, "PROGRAM FAILED TO ADD TMP MATRIX TO MATS ARRAY\n");
+		destroy_matrix(&temp);
+		return false;
+	}
+
+	/* a read only directory is no reason not to start */
+	if (!write_matrix("temp_mat", temp)) {
+		printf("Could not write temp_mat to the current directory\n");
+	}
+	return true;
+}
+
    	/* 
 	 * PURPOSE: frees the allocated heap memory
 	 * INPUT: 
@@ -286,7 +1094,7 @@ unsigned int find_matrix_given_name (Matrix_t** mats, unsigned int num_mats, con
 	 */
 void destroy_remaining_heap_allocations(Matrix_t **mats, unsigned int num_mats) {
 	
-	if( !(*mats) ){
+	if( !mats ){
 		printf("Null list of matrices.\n");
 		return;
 	}//TODO ERROR CHECK INCOMING PARAMETERS
@@ -1,4 +1,5 @@
 #include <stdio.h>
+#include <stdarg.h>
 #include <stdlib.h>
 #include <string.h>
 #include <stdbool.h>
@@ -8,15 +9,102 @@
 #include <sys/stat.h>
 #include <unistd.h>
 #include <errno.h>
+#include <stdint.h>
+#include <limits.h>
+#include <sys/mman.h>
 
 
 #include "matrix.h"
+#include "memory.h"
 
 
 #define MAX_CMD_COUNT 50
 
+/* "MTX2" in the first four bytes marks a matrix file with 64 bit dimensions */
+#define MATRIX_FILE_MAGIC 0x3258544d
+
+/* multi matrix kernels split the rows over threads once there is enough work, and walk each row in tiles */
+#define PARALLEL_THRESHOLD (1UL << 18)
+#define MAX_THREADS 16
+#define TILE_COLS 1024
+
+/* files loaded at once by read_matrices */
+#define IO_THREADS 8
+
+#define WORKSPACE_MAGIC "MATWKSP1"
+#define WORKSPACE_ALIGN 4096
+
+/* workspace archive layout: header, table of contents, then one page aligned payload per matrix */
+typedef struct {
+	char magic[8];
+	uint32_t count;
+	uint32_t align;
+}Workspace_Header_t;
+
+typedef struct {
+	char name[32];
+	uint64_t rows;
+	uint64_t cols;
+	uint64_t offset;
+}Workspace_Entry_t;
+
+/* the rows one thread of a multi matrix kernel works on */
+typedef struct {
+	Matrix_t** ms;
+	unsigned int n;
+	Reduce_Op_t op;
+	Matrix_t* vector;
+	Matrix_t* result;
+	unsigned int row_start;
+	unsigned int row_end;
+	unsigned long long sum;
+}Row_Band_t;
+
+/* one file of read_matrices, the matrix waits here until every file before it is in the mats array */
+typedef struct {
+	Matrix_t* m;
+	size_t bytes;
+	bool done;
+}Read_File_t;
+
+/* the files read_matrices shares out to its threads, everything past filenames is guarded by lock */
+typedef struct {
+	const char** filenames;
+	Read_File_t* files;
+	unsigned int n;
+	Matrix_t** mats;
+	unsigned int num_mats;
+	unsigned int next;
+	unsigned int next_start;
+	unsigned int next_add;
+	unsigned int added;
+	size_t budget;
+	size_t in_flight;
+	unsigned long long bytes;
+	pthread_mutex_t lock;
+	pthread_cond_t room;
+	FILE* out;
+}Read_Job_t;
+
+/* where the diagnostics of the calling thread go, NULL for stdout */
+static __thread FILE* report_stream = NULL;
+
 /*protected functions*/
-void load_matrix (Matrix_t* m, unsigned int* data);
+bool map_matrix (Matrix_t** m, const Workspace_Entry_t* entry, int fd);
+bool init_matrix_locks (Matrix_t* m);
+bool matrix_bytes (uint64_t rows, uint64_t cols, size_t* bytes);
+void print_file_error (const char* message);
+Matrix_t* matrix_root (Matrix_t* m);
+Matrix_Stats_t current_stats (Matrix_t* m);
+bool partially_overlap (Matrix_t* x, Matrix_t* y);
+unsigned long long run_row_bands (void* (*work)(void*), const Row_Band_t* job, unsigned int rows, size_t elements);
+void* reduce_band (void* arg);
+void* sum_band (void* arg);
+void* broadcast_band (void* arg);
+void* read_worker (void* arg);
+void add_read_matrices (Read_Job_t* job);
+void set_stats (Matrix_t* m, const Matrix_Stats_t* stats);
+unsigned int hist_bin (unsigned int value);
 
 	/* 
 	 * PURPOSE: instantiates a new matrix with the given name, rows, cols 
@@ -34,31 +122,99 @@ bool create_matrix (Matrix_t** new_matrix, const char* name, const unsigned int
 						const unsigned int cols) {
 
 	if( !name ){
-		printf("New matrix name is NULL.\n");
+		report("New matrix name is NULL.\n");
 		return false;
 	} //TODO ERROR CHECK INCOMING PARAMETERS
 
+	size_t bytes = 0;
+	if (!matrix_bytes(rows, cols, &bytes)) {
+		report("Matrix (%s,%u,%u) is too large.\n", name, rows, cols);
+		return false;
+	}
+
 	*new_matrix = calloc(1,sizeof(Matrix_t));
 	if (!(*new_matrix)) {
 		return false;
 	}
-	(*new_matrix)->data = calloc(rows * cols,sizeof(unsigned int));
+	(*new_matrix)->data = alloc_matrix_data(bytes, &(*new_matrix)->map_len);
+	(*new_matrix)->mem_bytes = bytes;
 	if (!(*new_matrix)->data) {
+		free(*new_matrix);
+		*new_matrix = NULL;
 		return false;
 	}
 	(*new_matrix)->rows = rows;
 	(*new_matrix)->cols = cols;
+	(*new_matrix)->stride = cols;
+	(*new_matrix)->refs = 1;
 	unsigned int len = strlen(name) + 1; 
 	if (len > MATRIX_NAME_LEN) {
+		free_matrix_data((*new_matrix)->data, bytes, (*new_matrix)->map_len);
+		free(*new_matrix);
+		*new_matrix = NULL;
+		return false;
+	}
+	memcpy((*new_matrix)->name,name,len);
+	/* a new matrix is all zeros so its statistics are known without a pass */
+	(*new_matrix)->stats.valid = STATS_ALL;
+	(*new_matrix)->stats.hist[0] = (unsigned long long)rows * cols;
+	if (!init_matrix_locks(*new_matrix)) {
+		free_matrix_data((*new_matrix)->data, bytes, (*new_matrix)->map_len);
+		free(*new_matrix);
+		*new_matrix = NULL;
 		return false;
 	}
-	strncpy((*new_matrix)->name,name,len);
 	return true;
 
 }
 
 	/* 
-	 * PURPOSE: frees the memory allocated for the matrix
+	 * PURPOSE: creates a view of a block of the given matrix that shares its data instead of copying it
+	 * INPUT: 
+	 *	view - the new view to be created
+	 *	name - the name of the view
+	 *	src - the matrix or view to take the block from
+	 *	row_start, row_end - the block covers rows row_start up to but not including row_end
+	 *	col_start, col_end - the block covers cols col_start up to but not including col_end
+	 * RETURN:
+	 *  True - if the view has been created
+	 *  Fasle - if the block is outside of src or there are errors in the process
+	 */
+bool slice_matrix (Matrix_t** view, const char* name, Matrix_t* src, unsigned int row_start, unsigned int row_end,
+		unsigned int col_start, unsigned int col_end) {
+
+	if (!view || !name || !src || strlen(name) + 1 > MATRIX_NAME_LEN) {
+		return false;
+	}
+	if (row_start > row_end || row_end > src->rows || col_start > col_end || col_end > src->cols) {
+		report("Slice (%u:%u,%u:%u) is outside of Matrix (%s,%u,%u)\n", row_start, row_end,
+			col_start, col_end, src->name, src->rows, src->cols);
+		return false;
+	}
+
+	*view = calloc(1, sizeof(Matrix_t));
+	if (!(*view) || !init_matrix_locks(*view)) {
+		free(*view);
+		*view = NULL;
+		return false;
+	}
+	/* views of views hang off the matrix that owns the data */
+	Matrix_t* root = matrix_root(src);
+	const size_t offset = (size_t)row_start * src->stride + col_start;
+	memcpy((*view)->name, name, strlen(name) + 1);
+	(*view)->rows = row_end - row_start;
+	(*view)->cols = col_end - col_start;
+	(*view)->stride = src->stride;
+	(*view)->data = src->data + offset;
+	(*view)->offset = src->offset + offset;
+	(*view)->parent = root;
+	(*view)->refs = 1;
+	__atomic_add_fetch(&root->refs, 1, __ATOMIC_SEQ_CST);
+	return true;
+}
+
+	/* 
+	 * PURPOSE: drops a reference to the matrix, its memory is freed once nothing refers to it
 	 * INPUT: 
 	 *	m - the matrix to be destroyed
 	 * RETURN:
@@ -66,9 +222,28 @@ bool create_matrix (Matrix_t** new_matrix, const char* name, const unsigned int
 	 */
 void destroy_matrix (Matrix_t** m) {
 
-	//TODO ERROR CHECK INCOMING PARAMETERS
+	if (!m || !(*m)) {
+		return;
+	}
+
+	/* views keep their parent alive after it leaves the array */
+	if (__atomic_sub_fetch(&(*m)->refs, 1, __ATOMIC_SEQ_CST) > 0) {
+		*m = NULL;
+		return;
+	}
 	
-	free((*m)->data);
+	untrack_matrix(*m);
+	if ((*m)->mapped) {
+		close((*m)->map_fd);
+	}
+	pthread_rwlock_destroy(&(*m)->lock);
+	pthread_mutex_destroy(&(*m)->stats_lock);
+	if ((*m)->parent) {
+		destroy_matrix(&(*m)->parent);
+	}
+	else if (!(*m)->spilled) {
+		free_matrix_data((*m)->data, (*m)->mem_bytes, (*m)->map_len);
+	}
 	free(*m);
 	*m = NULL;
 }
@@ -89,12 +264,17 @@ bool equal_matrices (Matrix_t* a, Matrix_t* b) {
 	if (!a || !b || !a->data || !b->data) {
 		return false;	
 	}
+	if (a->rows != b->rows || a->cols != b->cols) {
+		return false;
+	}
 
-	int result = memcmp(a->data,b->data, sizeof(unsigned int) * a->rows * a->cols);
-	if (result == 0) {
-		return true;
+	for (unsigned int i = 0; i < a->rows; ++i) {
+		if (memcmp(&a->data[(size_t)i * a->stride], &b->data[(size_t)i * b->stride],
+				sizeof(unsigned int) * (size_t)a->cols) != 0) {
+			return false;
+		}
 	}
-	return false;
+	return true;
 }
 
 	/* 
@@ -108,16 +288,27 @@ bool equal_matrices (Matrix_t* a, Matrix_t* b) {
 	 */
 bool duplicate_matrix (Matrix_t* src, Matrix_t* dest) {
 
-	if( !src || !dest ){
+	if( !src || !dest || src->rows != dest->rows || src->cols != dest->cols ){
 		return false;
 	}
 	//TODO ERROR CHECK INCOMING PARAMETERS
+	if (partially_overlap(dest, src)) {
+		report("Matrix (%s) overlaps Matrix (%s) without being the same block\n", dest->name, src->name);
+		return false;
+	}
+	if (dest->data == src->data) {
+		return true;
+	}
 
 	/*
 	 * copy over data
 	 */
-	unsigned int bytesToCopy = sizeof(unsigned int) * src->rows * src->cols;
-	memcpy(dest->data,src->data, bytesToCopy);	
+	size_t bytesToCopy = sizeof(unsigned int) * src->cols;
+	for (unsigned int i = 0; i < src->rows; ++i) {
+		memcpy(&dest->data[(size_t)i * dest->stride],&src->data[(size_t)i * src->stride], bytesToCopy);	
+	}
+	const Matrix_Stats_t stats = current_stats(src);
+	set_stats(dest, &stats);
 	return equal_matrices (src,dest);
 }
 
@@ -138,12 +329,18 @@ bool bitwise_shift_matrix (Matrix_t* a, char direction, unsigned int shift) {
 		return false;
 	}
 
-	if (direction == 'l') {
+	/* shifting an unsigned int by 32 or more is undefined in C, every bit is shifted out instead */
+	if (shift >= 32) {
+		for (unsigned int i = 0; i < a->rows; ++i) {
+			memset(&a->data[(size_t)i * a->stride], 0, a->cols * sizeof(unsigned int));
+		}
+	}
+	else if (direction == 'l') {
 		unsigned int i = 0;
 		for (; i < a->rows; ++i) {
 			unsigned int j = 0;
 			for (; j < a->cols; ++j) {
-				a->data[i * a->cols + j] = a->data[i * a->cols + j] << shift;
+				a->data[(size_t)i * a->stride + j] = a->data[(size_t)i * a->stride + j] << shift;
 			}
 		}
 
@@ -153,10 +350,46 @@ bool bitwise_shift_matrix (Matrix_t* a, char direction, unsigned int shift) {
 		for (; i < a->rows; ++i) {
 			unsigned int j = 0;
 			for (; j < a->cols; ++j) {
-				a->data[i * a->cols + j] = a->data[i * a->cols + j] >> shift;
+				a->data[(size_t)i * a->stride + j] = a->data[(size_t)i * a->stride + j] >> shift;
+			}
+		}
+	}
+
+	/*
+	 * shifting keeps the order of the numbers so the cached statistics can be
+	 * shifted along with them, unless a left shift pushed bits off the top
+	 */
+	Matrix_Stats_t shifted = current_stats(a);
+	Matrix_Stats_t* stats = &shifted;
+	if (shift >= 32) {
+		stats->valid = 0;
+	}
+	else if (direction == 'l') {
+		if ((stats->valid & STATS_MINMAX) && stats->max <= (UINT32_MAX >> shift)) {
+			stats->sum <<= shift;
+			stats->min <<= shift;
+			stats->max <<= shift;
+			for (int bin = MATRIX_HIST_BINS - 1; bin > 0; --bin) {
+				stats->hist[bin] = bin - (int)shift > 0 ? stats->hist[bin - shift] : 0;
+			}
+		}
+		else {
+			stats->valid = 0;
+		}
+	}
+	else {
+		stats->valid &= ~STATS_SUM;
+		stats->min >>= shift;
+		stats->max >>= shift;
+		for (unsigned int bin = 1; bin < MATRIX_HIST_BINS; ++bin) {
+			const unsigned int to = bin > shift ? bin - shift : 0;
+			if (to != bin) {
+				stats->hist[to] += stats->hist[bin];
+				stats->hist[bin] = 0;
 			}
 		}
 	}
+	set_stats(a, stats);
 	
 	return true;
 }
@@ -166,26 +399,226 @@ bool bitwise_shift_matrix (Matrix_t* a, char direction, unsigned int shift) {
 	 * INPUT: 
 	 *	a - the first matrix that will be added with the second matrix
 	 *	b - the second matrix that will be added with the first matrix
-	 *  c - the result matrix of a and b
+	 *  c - the result matrix of a and b, may be a or b itself to add in place
 	 * RETURN:
 	 *  True - if the contents of the two matricies are successfully and stored into the third
 	 *  Fasle - if there are errors with matrix a and b
 	 */
 bool add_matrices (Matrix_t* a, Matrix_t* b, Matrix_t* c) {
 
-	if( !a || !b ){
+	if( !a || !b || !c ){
 		return false;
 	}//TODO ERROR CHECK INCOMING PARAMETERS
 
-	if (a->rows != b->rows && a->cols != b->cols) {
+	if (a->rows != b->rows || a->cols != b->cols || a->rows != c->rows || a->cols != c->cols) {
 		return false;
 	}
+	if (partially_overlap(c, a) || partially_overlap(c, b)) {
+		report("Matrix (%s) overlaps an operand without being the same block\n", c->name);
+		return false;
+	}
+
+	/* if no position can wrap, which the two maximums show, the sum of c is the sum of both sums */
+	const Matrix_Stats_t a_stats = current_stats(a);
+	const Matrix_Stats_t b_stats = current_stats(b);
+	Matrix_Stats_t stats;
+	memset(&stats, 0, sizeof(stats));
+	if ((a_stats.valid & b_stats.valid & (STATS_SUM | STATS_MINMAX)) == (STATS_SUM | STATS_MINMAX)
+		&& (unsigned long long)a_stats.max + b_stats.max <= UINT32_MAX) {
+		stats.valid = STATS_SUM;
+		stats.sum = a_stats.sum + b_stats.sum;
+	}
+
+	for (unsigned int i = 0; i < a->rows; ++i) {
+		const unsigned int* a_row = &a->data[(size_t)i * a->stride];
+		const unsigned int* b_row = &b->data[(size_t)i * b->stride];
+		unsigned int* c_row = &c->data[(size_t)i * c->stride];
+		for (unsigned int j = 0; j < a->cols; ++j) {
+			c_row[j] = a_row[j] + b_row[j];
+		}
+	}
+	set_stats(c, &stats);
+	return true;
+}
 
-	for (int i = 0; i < a->rows; ++i) {
-		for (int j = 0; j < b->cols; ++j) {
-			c->data[i * a->cols +j] = a->data[i * a->cols + j] + b->data[i * a->cols + j];
+	/* 
+	 * PURPOSE: combines any number of same size matricies element by element into a result in one pass,
+	 *  each input is read once and the result is written once
+	 * INPUT: 
+	 *	ms - the matricies to combine
+	 *	n - the number of matricies in ms
+	 *	op - REDUCE_ADD sums them, REDUCE_MAX and REDUCE_MIN keep the largest or smallest number
+	 *	result - the matrix the result is stored in, may be one of ms
+	 * RETURN:
+	 *  True - if the result has been stored
+	 *  Fasle - if the sizes differ or there are errors with the matricies
+	 */
+bool reduce_matrices (Matrix_t** ms, unsigned int n, Reduce_Op_t op, Matrix_t* result) {
+
+	if (!ms || n == 0 || !result) {
+		return false;
+	}
+	/* 
+	 * only REDUCE_ADD has a sum worth keeping, and only while every input has a cached sum
+	 * and the maximums added together still fit in 32 bits
+	 */
+	Matrix_Stats_t stats;
+	memset(&stats, 0, sizeof(stats));
+	stats.valid = op == REDUCE_ADD ? STATS_SUM : 0;
+	unsigned long long max_total = 0;
+	for (unsigned int k = 0; k < n; ++k) {
+		if (!ms[k] || !ms[k]->data || ms[k]->rows != result->rows || ms[k]->cols != result->cols) {
+			return false;
+		}
+		if (partially_overlap(result, ms[k])) {
+			report("Matrix (%s) overlaps an operand without being the same block\n", result->name);
+			return false;
 		}
+		const Matrix_Stats_t k_stats = current_stats(ms[k]);
+		if ((k_stats.valid & (STATS_SUM | STATS_MINMAX)) != (STATS_SUM | STATS_MINMAX)) {
+			stats.valid = 0;
+		}
+		stats.sum += k_stats.sum;
+		max_total += k_stats.max;
+	}
+	if (max_total > UINT32_MAX) {
+		stats.valid = 0;
 	}
+
+	Row_Band_t job = {.ms = ms, .n = n, .op = op, .result = result};
+	run_row_bands(reduce_band, &job, result->rows, (size_t)result->rows * result->cols * n);
+	set_stats(result, &stats);
+	return true;
+}
+
+	/* 
+	 * PURPOSE: sums every number in a set of matricies, matricies with a cached sum are not read at all
+	 * INPUT: 
+	 *	ms - the matricies to sum, their sizes may differ
+	 *	n - the number of matricies in ms
+	 *	sum - where the total is stored
+	 * RETURN:
+	 *  True - if the total has been stored
+	 *  Fasle - if there are errors with the matricies
+	 */
+bool sum_all_matrices (Matrix_t** ms, unsigned int n, unsigned long long* sum) {
+
+	if (!ms || !sum) {
+		return false;
+	}
+	*sum = 0;
+	for (unsigned int k = 0; k < n; ++k) {
+		if (!ms[k] || !ms[k]->data) {
+			return false;
+		}
+		const Matrix_Stats_t k_stats = current_stats(ms[k]);
+		if (k_stats.valid & STATS_SUM) {
+			*sum += k_stats.sum;
+			continue;
+		}
+		Row_Band_t job = {.ms = &ms[k], .n = 1};
+		*sum += run_row_bands(sum_band, &job, ms[k]->rows, (size_t)ms[k]->rows * ms[k]->cols);
+	}
+	return true;
+}
+
+	/* 
+	 * PURPOSE: adds a row vector to every row or a column vector to every column of a matrix
+	 * INPUT: 
+	 *	a - the matrix
+	 *	vector - a 1 x cols matrix added to each row or a rows x 1 matrix added to each column
+	 *	result - the matrix the result is stored in, may be a itself
+	 * RETURN:
+	 *  True - if the result has been stored
+	 *  Fasle - if the sizes do not line up or there are errors with the matricies
+	 */
+bool broadcast_add_matrix (Matrix_t* a, Matrix_t* vector, Matrix_t* result) {
+
+	if (!a || !vector || !result || !a->data || !vector->data) {
+		return false;
+	}
+	const bool row_vector = vector->rows == 1 && vector->cols == a->cols;
+	const bool col_vector = vector->cols == 1 && vector->rows == a->rows;
+	if ((!row_vector && !col_vector) || result->rows != a->rows || result->cols != a->cols) {
+		return false;
+	}
+	if (partially_overlap(result, a) || partially_overlap(result, vector)) {
+		report("Matrix (%s) overlaps an operand without being the same block\n", result->name);
+		return false;
+	}
+
+	Matrix_t* ms[] = {a};
+	Row_Band_t job = {.ms = ms, .n = 1, .vector = vector, .result = result};
+	run_row_bands(broadcast_band, &job, a->rows, (size_t)a->rows * a->cols);
+	const Matrix_Stats_t stats = {0};
+	set_stats(result, &stats);
+	return true;
+}
+
+	/* 
+	 * PURPOSE: sums all of the numbers in the given matrix
+	 * INPUT: 
+	 *	m - the matrix whoes contents will be summed
+	 * RETURN:
+	 *  the sum of every number in the matrix, 0 if the matrix is NULL
+	 */
+unsigned long long sum_matrix (Matrix_t* m) {
+
+	Matrix_Stats_t stats;
+	if (!matrix_stats(m, &stats)) {
+		return 0;
+	}
+	return stats.sum;
+}
+
+	/* 
+	 * PURPOSE: gets the sum, min, max and histogram of the given matrix, computing
+	 *  whatever is not cached in one pass over the data and caching it
+	 * INPUT: 
+	 *	m - the matrix to get the statistics of, needs at least a read lock
+	 *	stats - where the statistics are copied to
+	 * RETURN:
+	 *  True - if stats holds every statistic of the matrix
+	 *  Fasle - if the matrix or stats is NULL
+	 */
+bool matrix_stats (Matrix_t* m, Matrix_Stats_t* stats) {
+
+	if (!m || !m->data || !stats) {
+		return false;
+	}
+
+	/* readers share the matrix so the cache itself needs its own lock */
+	pthread_mutex_lock(&m->stats_lock);
+	const unsigned long version = matrix_root(m)->data_version;
+	if (m->stats.valid != STATS_ALL || m->stats.version != version) {
+		unsigned long long sum = 0;
+		unsigned int min = UINT32_MAX;
+		unsigned int max = 0;
+		unsigned long long hist[MATRIX_HIST_BINS] = {0};
+		for (unsigned int i = 0; i < m->rows; ++i) {
+			const unsigned int* row = &m->data[(size_t)i * m->stride];
+			/* simple reductions first so the compiler can vectorize them, the row is still in cache for the histogram */
+			for (unsigned int j = 0; j < m->cols; ++j) {
+				sum += row[j];
+				min = row[j] < min ? row[j] : min;
+				max = row[j] > max ? row[j] : max;
+			}
+			for (unsigned int j = 0; j < m->cols; ++j) {
+				hist[hist_bin(row[j])]++;
+			}
+		}
+		if ((unsigned long long)m->rows * m->cols == 0) {
+			min = 0;
+		}
+		m->stats.sum = sum;
+		m->stats.min = min;
+		m->stats.max = max;
+		memcpy(m->stats.hist, hist, sizeof(hist));
+		m->stats.valid = STATS_ALL;
+		m->stats.version = version;
+	}
+	*stats = m->stats;
+	pthread_mutex_unlock(&m->stats_lock);
 	return true;
 }
 
@@ -193,23 +626,25 @@ bool add_matrices (Matrix_t* a, Matrix_t* b, Matrix_t* c) {
 	 * PURPOSE: displays the contents of the given matrix
 	 * INPUT: 
 	 *	m - the matrix whoes content will be printed
+	 *	out - the stream the contents are printed to
 	 * RETURN:
 	 *
 	 */
-void display_matrix (Matrix_t* m) {
+void display_matrix (Matrix_t* m, FILE* out) {
 	
-	//TODO ERROR CHECK INCOMING PARAMETERS
-
+	if (!m || !out) {
+		return;
+	}
 
-	printf("\nMatrix Contents (%s):\n", m->name);
-	printf("DIM = (%u,%u)\n", m->rows, m->cols);
+	fprintf(out, "\nMatrix Contents (%s):\n", m->name);
+	fprintf(out, "DIM = (%u,%u)\n", m->rows, m->cols);
 	for (int i = 0; i < m->rows; ++i) {
 		for (int j = 0; j < m->cols; ++j) {
-			printf("%u ", m->data[i * m->cols + j]);
+			fprintf(out, "%u ", m->data[(size_t)i * m->stride + j]);
 		}
-		printf("\n");
+		fprintf(out, "\n");
 	}
-	printf("\n");
+	fprintf(out, "\n");
 
 }
 
@@ -224,138 +659,166 @@ void display_matrix (Matrix_t* m) {
 	 */
 bool read_matrix (const char* matrix_input_filename, Matrix_t** m) {
 	
-	if( !matrix_input_filename ){
+	if( !matrix_input_filename || !m ){
 		return false;
 	}//TODO ERROR CHECK INCOMING PARAMETERS
 
 
 	int fd = open(matrix_input_filename,O_RDONLY);
 	if (fd < 0) {
-		printf("FAILED TO OPEN FOR READING\n");
-		if (errno == EACCES ) {
-			perror("DO NOT HAVE ACCESS TO FILE\n");
-		}
-		else if (errno == EADDRINUSE ){
-			perror("FILE ALREADY IN USE\n");
-		}
-		else if (errno == EBADF) {
-			perror("BAD FILE DESCRIPTOR\n");	
-		}
-		else if (errno == EEXIST) {
-			perror("FILE EXIST\n");
-		}
+		print_file_error("FAILED TO OPEN FOR READING\n");
 		return false;
 	}
+	/* the whole file is read front to back, let the kernel read ahead of us */
+	posix_fadvise(fd, 0, 0, POSIX_FADV_SEQUENTIAL);
+	posix_fadvise(fd, 0, 0, POSIX_FADV_WILLNEED);
 
-	/*read the wrote dimensions and name length*/
-	unsigned int name_len = 0;
-	unsigned int rows = 0;
-	unsigned int cols = 0;
+	/*
+	 * read the wrote dimensions and name length, new files start with a magic
+	 * number and have 64 bit dimensions, old files start with the name length
+	 */
+	uint32_t first = 0;
+	uint32_t name_len = 0;
+	uint64_t rows = 0;
+	uint64_t cols = 0;
+	bool wide = false;
 	
-	if (read(fd,&name_len,sizeof(unsigned int)) != sizeof(unsigned int)) {
-		printf("FAILED TO READING FILE\n");
-		if (errno == EACCES ) {
-			perror("DO NOT HAVE ACCESS TO FILE\n");
-		}
-		else if (errno == EADDRINUSE ){
-			perror("FILE ALREADY IN USE\n");
-		}
-		else if (errno == EBADF) {
-			perror("BAD FILE DESCRIPTOR\n");	
-		}
-		else if (errno == EEXIST) {
-			perror("FILE EXIST\n");
-		}
+	if (!read_fully(fd,&first,sizeof(first),FILE_CURSOR)) {
+		print_file_error("FAILED TO READING FILE\n");
+		close(fd);
 		return false;
 	}
-	char name_buffer[50];
-	if (read (fd,name_buffer,sizeof(char) * name_len) != sizeof(char) * name_len) {
-		printf("FAILED TO READ MATRIX NAME\n");
-		if (errno == EACCES ) {
-			perror("DO NOT HAVE ACCESS TO FILE\n");
-		}
-		else if (errno == EADDRINUSE ){
-			perror("FILE ALREADY IN USE\n");
-		}
-		else if (errno == EBADF) {
-			perror("BAD FILE DESCRIPTOR\n");	
-		}
-		else if (errno == EEXIST) {
-			perror("FILE EXIST\n");
+	if (first == MATRIX_FILE_MAGIC) {
+		wide = true;
+		if (!read_fully(fd,&name_len,sizeof(name_len),FILE_CURSOR)) {
+			print_file_error("FAILED TO READING FILE\n");
+			close(fd);
+			return false;
 		}
+	}
+	else {
+		name_len = first;
+	}
+	if (name_len == 0 || name_len > MATRIX_NAME_LEN) {
+		report("NOT A MATRIX FILE\n");
+		close(fd);
+		return false;
+	}
 
+	char name_buffer[MATRIX_NAME_LEN];
+	if (!read_fully(fd,name_buffer,sizeof(char) * name_len,FILE_CURSOR)) {
+		print_file_error("FAILED TO READ MATRIX NAME\n");
+		close(fd);
 		return false;	
 	}
+	name_buffer[name_len - 1] = '\0';
 
-	if (read (fd,&rows, sizeof(unsigned int)) != sizeof(unsigned int)) {
-		printf("FAILED TO READ MATRIX ROW SIZE\n");
-		if (errno == EACCES ) {
-			perror("DO NOT HAVE ACCESS TO FILE\n");
+	if (wide) {
+		if (!read_fully(fd,&rows,sizeof(rows),FILE_CURSOR) || !read_fully(fd,&cols,sizeof(cols),FILE_CURSOR)) {
+			print_file_error("FAILED TO READ MATRIX SIZE\n");
+			close(fd);
+			return false;
 		}
-		else if (errno == EADDRINUSE ){
-			perror("FILE ALREADY IN USE\n");
-		}
-		else if (errno == EBADF) {
-			perror("BAD FILE DESCRIPTOR\n");	
-		}
-		else if (errno == EEXIST) {
-			perror("FILE EXIST\n");
+	}
+	else {
+		uint32_t narrow_rows = 0;
+		uint32_t narrow_cols = 0;
+		if (!read_fully(fd,&narrow_rows,sizeof(narrow_rows),FILE_CURSOR) || !read_fully(fd,&narrow_cols,sizeof(narrow_cols),FILE_CURSOR)) {
+			print_file_error("FAILED TO READ MATRIX SIZE\n");
+			close(fd);
+			return false;
 		}
+		rows = narrow_rows;
+		cols = narrow_cols;
+	}
 
+	/* check the size against the file before allocating anything for it */
+	size_t numberOfDataBytes = 0;
+	struct stat st;
+	if (rows > UINT32_MAX || cols > UINT32_MAX || !matrix_bytes(rows, cols, &numberOfDataBytes)
+		|| fstat(fd, &st) || lseek(fd, 0, SEEK_CUR) + numberOfDataBytes > (uint64_t)st.st_size) {
+		report("MATRIX SIZE (%llu,%llu) DOES NOT MATCH THE FILE\n", (unsigned long long)rows, (unsigned long long)cols);
+		close(fd);
 		return false;
 	}
 
-	if (read(fd,&cols,sizeof(unsigned int)) != sizeof(unsigned int)) {
-		printf("FAILED TO READ MATRIX COLUMN SIZE\n");
-		if (errno == EACCES ) {
-			perror("DO NOT HAVE ACCESS TO FILE\n");
-		}
-		else if (errno == EADDRINUSE ){
-			perror("FILE ALREADY IN USE\n");
-		}
-		else if (errno == EBADF) {
-			perror("BAD FILE DESCRIPTOR\n");	
-		}
-		else if (errno == EEXIST) {
-			perror("FILE EXIST\n");
-		}
-
+	if (!create_matrix(m,name_buffer,rows,cols)) {
+		close(fd);
 		return false;
 	}
 
-	unsigned int numberOfDataBytes = rows * cols * sizeof(unsigned int);
-	unsigned int *data = calloc(rows * cols, sizeof(unsigned int));
-	if (read(fd,data,numberOfDataBytes) != numberOfDataBytes) {
-		printf("FAILED TO READ MATRIX DATA\n");
-		if (errno == EACCES ) {
-			perror("DO NOT HAVE ACCESS TO FILE\n");
-		}
-		else if (errno == EADDRINUSE ){
-			perror("FILE ALREADY IN USE\n");
-		}
-		else if (errno == EBADF) {
-			perror("BAD FILE DESCRIPTOR\n");	
-		}
-		else if (errno == EEXIST) {
-			perror("FILE EXIST\n");
-		}
-
+	if (!read_fully(fd,(*m)->data,numberOfDataBytes,FILE_CURSOR)) {
+		print_file_error("FAILED TO READ MATRIX DATA\n");
+		destroy_matrix(m);
+		close(fd);
 		return false;	
 	}
+	const Matrix_Stats_t stats = {0};
+	set_stats(*m, &stats);
 
-	if (!create_matrix(m,name_buffer,rows,cols)) {
-		return false;
-	}
-
-	load_matrix(*m,data);
-	free(data);
 	if (close(fd)) {
+		destroy_matrix(m);
 		return false;
 
 	}
 	return true;
 }
 
+	/* 
+	 * PURPOSE: reads many matrix files at once on a fixed number of threads and adds them to the mats
+	 *  array in the order of filenames, the caller holds the array exclusively
+	 * INPUT: 
+	 *	filenames - the files to read
+	 *	n - the number of files
+	 *	mats - the array the matricies are added to
+	 *	num_mats - the number of slots in mats
+	 *	bytes - set to the number of bytes of matrix data read
+	 * RETURN:
+	 *  the number of matricies that have been added
+	 */
+unsigned int read_matrices (const char** filenames, unsigned int n, Matrix_t** mats, unsigned int num_mats,
+		unsigned long long* bytes) {
+
+	if (!filenames || !mats || !bytes) {
+		return 0;
+	}
+
+	Memory_Usage_t usage;
+	memory_usage(&usage);
+	Read_Job_t job = {.filenames = filenames, .n = n, .mats = mats, .num_mats = num_mats,
+		.budget = usage.budget, .out = report_stream};
+	job.files = calloc(n ? n : 1, sizeof(Read_File_t));
+	if (!job.files || pthread_mutex_init(&job.lock, NULL)) {
+		free(job.files);
+		return 0;
+	}
+	if (pthread_cond_init(&job.room, NULL)) {
+		pthread_mutex_destroy(&job.lock);
+		free(job.files);
+		return 0;
+	}
+
+	pthread_t ids[IO_THREADS];
+	bool started[IO_THREADS] = {false};
+	const unsigned int threads = n < IO_THREADS ? n : IO_THREADS;
+	for (unsigned int t = 1; t < threads; ++t) {
+		started[t] = pthread_create(&ids[t], NULL, read_worker, &job) == 0;
+	}
+	/* the calling thread reads too, so nothing is lost if no thread could be started */
+	read_worker(&job);
+	for (unsigned int t = 1; t < threads; ++t) {
+		if (started[t]) {
+			pthread_join(ids[t], NULL);
+		}
+	}
+
+	pthread_cond_destroy(&job.room);
+	pthread_mutex_destroy(&job.lock);
+	free(job.files);
+	*bytes = job.bytes;
+	return job.added;
+}
+
 	/* 
 	 * PURPOSE: writes the contents of the given matrix to a file
 	 * INPUT: 
@@ -374,66 +837,270 @@ bool write_matrix (const char* matrix_output_filename, Matrix_t* m) {
 	int fd = open (matrix_output_filename, O_CREAT | O_RDWR | O_TRUNC, 0644);
 	/* ERROR HANDLING USING errorno*/
 	if (fd < 0) {
-		printf("FAILED TO CREATE/OPEN FILE FOR WRITING\n");
-		if (errno == EACCES ) {
-			perror("DO NOT HAVE ACCESS TO FILE\n");
-		}
-		else if (errno == EADDRINUSE ){
-			perror("FILE ALREADY IN USE\n");
-		}
-		else if (errno == EBADF) {
-			perror("BAD FILE DESCRIPTOR\n");	
-		}
-		else if (errno == EEXIST) {
-			perror("FILE EXISTS\n");
-		}
+		print_file_error("FAILED TO CREATE/OPEN FILE FOR WRITING\n");
 		return false;
 	}
-	/* Calculate the needed buffer for our matrix */
-	unsigned int name_len = strlen(m->name) + 1;
-	unsigned int numberOfBytes = sizeof(unsigned int) + (sizeof(unsigned int)  * 2) + name_len + sizeof(unsigned int) * m->rows * m->cols + 1;
+	/* Calculate the needed buffer for our header */
+	const uint32_t magic = MATRIX_FILE_MAGIC;
+	const uint32_t name_len = strlen(m->name) + 1;
+	const uint64_t rows = m->rows;
+	const uint64_t cols = m->cols;
 	/* Allocate the output_buffer in bytes
 	 * IMPORTANT TO UNDERSTAND THIS WAY OF MOVING MEMORY
 	 */
-	unsigned char* output_buffer = calloc(numberOfBytes,sizeof(unsigned char));
-	unsigned int offset = 0;
-	memcpy(&output_buffer[offset], &name_len, sizeof(unsigned int)); // IMPORTANT C FUNCTION TO KNOW
-	offset += sizeof(unsigned int);	
+	unsigned char output_buffer[sizeof(magic) + sizeof(name_len) + MATRIX_NAME_LEN + sizeof(rows) + sizeof(cols)];
+	size_t offset = 0;
+	memcpy(&output_buffer[offset], &magic, sizeof(magic)); // IMPORTANT C FUNCTION TO KNOW
+	offset += sizeof(magic);
+	memcpy(&output_buffer[offset], &name_len, sizeof(name_len));
+	offset += sizeof(name_len);	
 	memcpy(&output_buffer[offset], m->name,name_len);
 	offset += name_len;
-	memcpy(&output_buffer[offset],&m->rows,sizeof(unsigned int));
-	offset += sizeof(unsigned int);
-	memcpy(&output_buffer[offset],&m->cols,sizeof(unsigned int));
-	offset += sizeof(unsigned int);
-	memcpy (&output_buffer[offset],m->data,m->rows * m->cols * sizeof(unsigned int));
-	offset += (m->rows * m->cols * sizeof(unsigned int));
-	output_buffer[numberOfBytes - 1] = EOF;
+	memcpy(&output_buffer[offset],&rows,sizeof(rows));
+	offset += sizeof(rows);
+	memcpy(&output_buffer[offset],&cols,sizeof(cols));
+	offset += sizeof(cols);
 
-	if (write(fd,output_buffer,numberOfBytes) != numberOfBytes) {
-		printf("FAILED TO WRITE MATRIX TO FILE\n");
-		if (errno == EACCES ) {
-			perror("DO NOT HAVE ACCESS TO FILE\n");
-		}
-		else if (errno == EADDRINUSE ){
-			perror("FILE ALREADY IN USE\n");
-		}
-		else if (errno == EBADF) {
-			perror("BAD FILE DESCRIPTOR\n");	
-		}
-		else if (errno == EEXIST) {
-			perror("FILE EXIST\n");
-		}
+	/* the data goes straight from the matrix, a row at a time for views */
+	bool ok = write_fully(fd,output_buffer,offset,FILE_CURSOR);
+	const size_t row_bytes = (size_t)m->cols * sizeof(unsigned int);
+	if (ok && m->stride == m->cols) {
+		ok = write_fully(fd,m->data,row_bytes * m->rows,FILE_CURSOR);
+	}
+	for (unsigned int i = 0; ok && m->stride != m->cols && i < m->rows; ++i) {
+		ok = write_fully(fd,&m->data[(size_t)i * m->stride],row_bytes,FILE_CURSOR);
+	}
+	if (!ok) {
+		print_file_error("FAILED TO WRITE MATRIX TO FILE\n");
+		close(fd);
 		return false;
 	}
 	
 	if (close(fd)) {
 		return false;
 	}
-	free(output_buffer);
 
 	return true;
 }
 
+	/* 
+	 * PURPOSE: saves every matrix in the array into one archive whose payloads can be mapped back in
+	 * INPUT: 
+	 *	workspace_filename - the name of the archive file to create
+	 *	mats - the array of matricies, NULL slots are skipped
+	 *	num_mats - the number of slots in the array
+	 * RETURN:
+	 *  True - if every matrix has been written to the archive
+	 *  Fasle - if there are errors in the process
+	 */
+bool save_workspace (const char* workspace_filename, Matrix_t** mats, unsigned int num_mats) {
+
+	if (!workspace_filename || !mats) {
+		return false;
+	}
+
+	/* payloads must land on page boundaries for mmap, never use less than the system page */
+	long page_size = sysconf(_SC_PAGESIZE);
+	const uint64_t align = page_size > WORKSPACE_ALIGN ? page_size : WORKSPACE_ALIGN;
+
+	Workspace_Header_t header;
+	memset(&header, 0, sizeof(header));
+	memcpy(header.magic, WORKSPACE_MAGIC, sizeof(header.magic));
+	header.align = align;
+	for (unsigned int i = 0; i < num_mats; ++i) {
+		if (mats[i]) {
+			header.count++;
+		}
+	}
+
+	Workspace_Entry_t* entries = calloc(header.count ? header.count : 1, sizeof(Workspace_Entry_t));
+	if (!entries) {
+		return false;
+	}
+	uint64_t offset = sizeof(header) + sizeof(Workspace_Entry_t) * header.count;
+	unsigned int e = 0;
+	for (unsigned int i = 0; i < num_mats; ++i) {
+		if (!mats[i]) {
+			continue;
+		}
+		offset = (offset + align - 1) / align * align;
+		strncpy(entries[e].name, mats[i]->name, sizeof(entries[e].name) - 1);
+		entries[e].rows = mats[i]->rows;
+		entries[e].cols = mats[i]->cols;
+		entries[e].offset = offset;
+		offset += entries[e].rows * entries[e].cols * sizeof(unsigned int);
+		++e;
+	}
+
+	/*
+	 * matricies loaded from the archive are still mappings of it, truncating it under them would lose
+	 * their data, so the new archive is written next to it and renamed over it, the old file lives on
+	 * for the mappings until they are gone
+	 */
+	char temp_filename[PATH_MAX];
+	if (snprintf(temp_filename, sizeof(temp_filename), "%s.XXXXXX", workspace_filename) >= (int)sizeof(temp_filename)) {
+		report("WORKSPACE FILE NAME IS TOO LONG\n");
+		free(entries);
+		return false;
+	}
+	int fd = mkstemp(temp_filename);
+	if (fd < 0 || fchmod(fd, 0644)) {
+		report("FAILED TO CREATE/OPEN FILE FOR WRITING\n");
+		if (fd >= 0) {
+			close(fd);
+			unlink(temp_filename);
+		}
+		free(entries);
+		return false;
+	}
+
+	bool ok = write_fully(fd, &header, sizeof(header), 0)
+		&& write_fully(fd, entries, sizeof(Workspace_Entry_t) * header.count, sizeof(header));
+	e = 0;
+	for (unsigned int i = 0; i < num_mats && ok; ++i) {
+		if (!mats[i]) {
+			continue;
+		}
+		const size_t row_bytes = entries[e].cols * sizeof(unsigned int);
+		if (mats[i]->spilled) {
+			ok = copy_spilled_data(mats[i], fd, entries[e].offset);
+		}
+		else if (mats[i]->stride == mats[i]->cols) {
+			ok = write_fully(fd, mats[i]->data, row_bytes * entries[e].rows, entries[e].offset);
+		}
+		else {
+			/* views are saved as plain matricies one row at a time */
+			for (unsigned int r = 0; r < mats[i]->rows && ok; ++r) {
+				ok = write_fully(fd, &mats[i]->data[(size_t)r * mats[i]->stride], row_bytes,
+					entries[e].offset + r * row_bytes);
+			}
+		}
+		++e;
+	}
+	/* pad the last payload out so it can be mapped as whole pages */
+	if (ok && ftruncate(fd, (offset + align - 1) / align * align)) {
+		ok = false;
+	}
+	if (ok && fsync(fd)) {
+		ok = false;
+	}
+	if (!ok) {
+		report("FAILED TO WRITE WORKSPACE TO FILE: %s\n", strerror(errno));
+	}
+
+	free(entries);
+	if (close(fd) || !ok || rename(temp_filename, workspace_filename)) {
+		if (ok) {
+			report("FAILED TO REPLACE WORKSPACE FILE: %s\n", strerror(errno));
+		}
+		unlink(temp_filename);
+		return false;
+	}
+	return true;
+}
+
+	/* 
+	 * PURPOSE: maps every matrix of a workspace archive into the array without copying the payloads
+	 * INPUT: 
+	 *	workspace_filename - the name of the archive file made by save_workspace
+	 *	mats - the array of matricies the loaded matricies are added to
+	 *	num_mats - the number of slots in the array
+	 * RETURN:
+	 *  the number of matricies loaded
+	 *  -1 - if the archive is not valid or does not fit in the array
+	 */
+int load_workspace (const char* workspace_filename, Matrix_t** mats, unsigned int num_mats) {
+
+	if (!workspace_filename || !mats) {
+		return -1;
+	}
+
+	int fd = open(workspace_filename, O_RDONLY);
+	if (fd < 0) {
+		report("FAILED TO OPEN FOR READING\n");
+		return -1;
+	}
+
+	Workspace_Header_t header;
+	struct stat st;
+	if (!read_fully(fd, &header, sizeof(header), 0) || fstat(fd, &st)
+		|| memcmp(header.magic, WORKSPACE_MAGIC, sizeof(header.magic)) != 0) {
+		report("NOT A WORKSPACE FILE\n");
+		close(fd);
+		return -1;
+	}
+	if (header.count > num_mats) {
+		report("WORKSPACE HAS %u MATRICES BUT ONLY %u FIT\n", header.count, num_mats);
+		close(fd);
+		return -1;
+	}
+
+	Workspace_Entry_t* entries = calloc(header.count ? header.count : 1, sizeof(Workspace_Entry_t));
+	if (!entries || !read_fully(fd, entries, sizeof(Workspace_Entry_t) * header.count, sizeof(header))) {
+		report("FAILED TO READ WORKSPACE TABLE OF CONTENTS\n");
+		free(entries);
+		close(fd);
+		return -1;
+	}
+
+	/* check the whole table first so a bad archive loads nothing */
+	for (unsigned int i = 0; i < header.count; ++i) {
+		entries[i].name[sizeof(entries[i].name) - 1] = '\0';
+		size_t bytes = 0;
+		if (strlen(entries[i].name) + 1 > MATRIX_NAME_LEN || entries[i].rows > UINT32_MAX
+			|| entries[i].cols > UINT32_MAX || !matrix_bytes(entries[i].rows, entries[i].cols, &bytes)
+			|| entries[i].offset > (uint64_t)st.st_size || bytes > st.st_size - entries[i].offset) {
+			report("WORKSPACE ENTRY %u IS CORRUPT\n", i);
+			free(entries);
+			close(fd);
+			return -1;
+		}
+	}
+
+	/* entries replace the matricies with their names, the rest need a free slot each */
+	unsigned int free_slots = 0;
+	for (unsigned int j = 0; j < num_mats; ++j) {
+		free_slots += mats[j] == NULL;
+	}
+	unsigned int new_names = 0;
+	for (unsigned int i = 0; i < header.count; ++i) {
+		bool known = false;
+		for (unsigned int j = 0; j < num_mats && !known; ++j) {
+			known = mats[j] && strncmp(mats[j]->name, entries[i].name, MATRIX_NAME_LEN) == 0;
+		}
+		for (unsigned int k = 0; k < i && !known; ++k) {
+			known = strncmp(entries[k].name, entries[i].name, MATRIX_NAME_LEN) == 0;
+		}
+		new_names += !known;
+	}
+	if (new_names > free_slots) {
+		report("WORKSPACE HAS %u NEW MATRICES BUT ONLY %u SLOTS ARE FREE\n", new_names, free_slots);
+		free(entries);
+		close(fd);
+		return -1;
+	}
+
+	int loaded = 0;
+	for (unsigned int i = 0; i < header.count; ++i) {
+		Matrix_t* m = NULL;
+		if (!map_matrix(&m, &entries[i], fd)) {
+			report("FAILED TO MAP MATRIX (%s)\n", entries[i].name);
+			continue;
+		}
+		if (add_matrix_to_array(mats, m, num_mats) == MATRIX_ARRAY_ERROR) {
+			destroy_matrix(&m);
+			continue;
+		}
+		/* a workspace bigger than the budget may spill the matricies it loaded first */
+		next_command_epoch();
+		++loaded;
+	}
+
+	free(entries);
+	close(fd);
+	return loaded;
+}
+
 	/* 
 	 * PURPOSE: randomizes the numbers in the given matrix within a specific range
 	 * INPUT: 
@@ -450,33 +1117,48 @@ bool random_matrix(Matrix_t* m, unsigned int start_range, unsigned int end_range
 		return false;
 	}//TODO ERROR CHECK INCOMING PARAMETERS
 
+	/* the full range of an unsigned int has 2^32 numbers, one more than fits in it */
+	const unsigned long long span = (unsigned long long)end_range - start_range + 1;
 	for (unsigned int i = 0; i < m->rows; ++i) {
 		for (unsigned int j = 0; j < m->cols; ++j) {
-			m->data[i * m->cols + j] = rand() % (end_range + 1 - start_range) + start_range;
+			m->data[(size_t)i * m->stride + j] = rand() % span + start_range;
 		}
 	}
+	const Matrix_Stats_t stats = {0};
+	set_stats(m, &stats);
 	return true;
 }
 
-/*Protected Functions in C*/
+	/* 
+	 * PURPOSE: sends the diagnostics of the calling thread to a stream, so a server can report why a
+	 *  command failed to the client that sent it
+	 * INPUT: 
+	 *	out - the stream, NULL for stdout
+	 * RETURN:
+	 *
+	 */
+void set_report_stream (FILE* out) {
+
+	report_stream = out;
+}
 
 	/* 
-	 * PURPOSE: copies the given data into the given matrix
+	 * PURPOSE: prints a diagnostic to the stream set for the calling thread
 	 * INPUT: 
-	 *	m - the matrix that will be loaded with the given data
-	 *	data - the numbers that will be loaded into the matrix
+	 *	format - a printf format
 	 * RETURN:
-	 * 
+	 *
 	 */
-void load_matrix (Matrix_t* m, unsigned int* data) {
-	
-	if( !m || !data ){
-		printf("Null pointer to matrix or data");
-		return;
-	}//TODO ERROR CHECK INCOMING PARAMETERS
-	memcpy(m->data,data,m->rows * m->cols * sizeof(unsigned int));
+void report (const char* format, ...) {
+
+	va_list args;
+	va_start(args, format);
+	vfprintf(report_stream ? report_stream : stdout, format, args);
+	va_end(args);
 }
 
+/*Protected Functions in C*/
+
 	/* 
 	 * PURPOSE: adds the given matrix to the given array
 	 * INPUT: 
@@ -485,19 +1167,551 @@ void load_matrix (Matrix_t* m, unsigned int* data) {
 	 *	num_mats - the number of matricies
 	 * RETURN:
 	 *  pos - an int value of the next poition in the array after the matrix was added
+	 *  MATRIX_ARRAY_ERROR - if the new matrix is NULL or every slot holds another matrix
 	 */
 unsigned int add_matrix_to_array (Matrix_t** mats, Matrix_t* new_matrix, unsigned int num_mats) {
 	
 	if( !new_matrix ){
-		return 99;
+		return MATRIX_ARRAY_ERROR;
 	}//TODO ERROR CHECK INCOMING PARAMETERS
-	
-	static long int current_position = 0;
-	const long int pos = current_position % num_mats;
-	if ( mats[pos] ) {
-		destroy_matrix(&mats[pos]);
-	} 
+
+	/* a new matrix replaces the one with the same name so names stay unique */
+	unsigned int pos = MATRIX_ARRAY_ERROR;
+	for (unsigned int i = 0; i < num_mats; ++i) {
+		if (mats[i] && mats[i] != new_matrix && strncmp(mats[i]->name, new_matrix->name, MATRIX_NAME_LEN) == 0) {
+			untrack_matrix(mats[i]);
+			destroy_matrix(&mats[i]);
+			pos = i;
+			break;
+		}
+		if (!mats[i] && pos == MATRIX_ARRAY_ERROR) {
+			pos = i;
+		}
+	}
+	/* never throw away a matrix to make room, the memory budget spills them instead */
+	if (pos == MATRIX_ARRAY_ERROR) {
+		report("ALL %u MATRIX SLOTS ARE IN USE\n", num_mats);
+		return MATRIX_ARRAY_ERROR;
+	}
 	mats[pos] = new_matrix;
-	current_position++;
+	track_matrix(new_matrix);
 	return pos;
 }
+
+	/* 
+	 * PURPOSE: takes the reader/writer locks of a set of matrices in a fixed order
+	 * INPUT: 
+	 *	ms - the matrices to lock, duplicates and NULLs are allowed
+	 *	n - the number of matrices in ms
+	 *	writer - the one matrix in ms that will be modified, NULL if none
+	 * RETURN:
+	 *
+	 */
+void lock_matrices (Matrix_t** ms, unsigned int n, Matrix_t* writer) {
+
+	if (!ms) {
+		return;
+	}
+
+	/*
+	 * views share the lock of the matrix that owns their data, always lock
+	 * those in address order so two commands can never deadlock
+	 */
+	writer = matrix_root(writer);
+	Matrix_t* prev = NULL;
+	for (;;) {
+		Matrix_t* next = NULL;
+		for (unsigned int i = 0; i < n; ++i) {
+			Matrix_t* root = matrix_root(ms[i]);
+			if (root && root > prev && (!next || root < next)) {
+				next = root;
+			}
+		}
+		if (!next) {
+			break;
+		}
+		if (next == writer) {
+			pthread_rwlock_wrlock(&next->lock);
+		}
+		else {
+			pthread_rwlock_rdlock(&next->lock);
+		}
+		prev = next;
+	}
+}
+
+	/* 
+	 * PURPOSE: releases the locks taken by lock_matrices
+	 * INPUT: 
+	 *	ms - the same matrices that were given to lock_matrices
+	 *	n - the number of matrices in ms
+	 * RETURN:
+	 *
+	 */
+void unlock_matrices (Matrix_t** ms, unsigned int n) {
+
+	if (!ms) {
+		return;
+	}
+
+	for (unsigned int i = 0; i < n; ++i) {
+		Matrix_t* root = matrix_root(ms[i]);
+		bool seen = false;
+		for (unsigned int j = 0; j < i; ++j) {
+			if (matrix_root(ms[j]) == root) {
+				seen = true;
+			}
+		}
+		if (root && !seen) {
+			pthread_rwlock_unlock(&root->lock);
+		}
+	}
+}
+
+	/* 
+	 * PURPOSE: creates a matrix whose data is a private mapping of its payload in a workspace archive,
+	 *  pages are only read in when first touched and writes never reach the file
+	 * INPUT: 
+	 *	m - the new matrix to be created
+	 *	entry - the table of contents entry of the matrix
+	 *	fd - the open workspace archive
+	 * RETURN:
+	 *  True - if the matrix has been created
+	 *  Fasle - if there are errors in the process
+	 */
+bool map_matrix (Matrix_t** m, const Workspace_Entry_t* entry, int fd) {
+
+	if (!m || !entry) {
+		return false;
+	}
+
+	const size_t bytes = entry->rows * entry->cols * sizeof(unsigned int);
+	const long page_size = sysconf(_SC_PAGESIZE);
+	if (bytes == 0 || entry->offset % page_size != 0) {
+		/* nothing to map or not mappable on this system, fall back to a plain copy */
+		if (!create_matrix(m, entry->name, entry->rows, entry->cols)) {
+			return false;
+		}
+		if (!read_fully(fd, (*m)->data, bytes, entry->offset)) {
+			destroy_matrix(m);
+			return false;
+		}
+		/* create_matrix cached the statistics of a matrix of zeros */
+		Matrix_Stats_t stats = {0};
+		set_stats(*m, &stats);
+		return true;
+	}
+
+	/* 
+	 * every page becomes anonymous memory once it is written, so the whole mapping counts against the budget,
+	 * the matrix keeps its own descriptor of the archive to map it again after being spilled unchanged
+	 */
+	if (!reserve_matrix_data(bytes)) {
+		return false;
+	}
+	void* data = mmap(NULL, bytes, PROT_READ | PROT_WRITE, MAP_PRIVATE, fd, entry->offset);
+	if (data == MAP_FAILED) {
+		free_matrix_data(NULL, bytes, 0);
+		return false;
+	}
+	const int map_fd = dup(fd);
+	*m = map_fd < 0 ? NULL : calloc(1, sizeof(Matrix_t));
+	if (!(*m) || !init_matrix_locks(*m)) {
+		if (map_fd >= 0) {
+			close(map_fd);
+		}
+		free(*m);
+		*m = NULL;
+		free_matrix_data(data, bytes, bytes);
+		return false;
+	}
+	memcpy((*m)->name, entry->name, strlen(entry->name) + 1);
+	(*m)->rows = entry->rows;
+	(*m)->cols = entry->cols;
+	(*m)->stride = entry->cols;
+	(*m)->refs = 1;
+	(*m)->data = data;
+	(*m)->map_len = bytes;
+	(*m)->mem_bytes = bytes;
+	(*m)->mapped = true;
+	(*m)->map_fd = map_fd;
+	(*m)->map_offset = entry->offset;
+	(*m)->map_version = (*m)->data_version;
+	return true;
+}
+
+	/* 
+	 * PURPOSE: initializes the reader/writer lock and the statistics lock of a new matrix
+	 * INPUT: 
+	 *	m - the matrix whoes locks are initialized
+	 * RETURN:
+	 *  True - if both locks are ready
+	 *  Fasle - if either lock could not be initialized
+	 */
+bool init_matrix_locks (Matrix_t* m) {
+
+	if (!m || pthread_rwlock_init(&m->lock, NULL)) {
+		return false;
+	}
+	if (pthread_mutex_init(&m->stats_lock, NULL)) {
+		pthread_rwlock_destroy(&m->lock);
+		return false;
+	}
+	return true;
+}
+
+	/* 
+	 * PURPOSE: finds the histogram bin of a number, which is the position of its highest set bit
+	 * INPUT: 
+	 *	value - the number to bin
+	 * RETURN:
+	 *  0 for zero, otherwise 1 through 32
+	 */
+unsigned int hist_bin (unsigned int value) {
+	return value ? 32 - __builtin_clz(value) : 0;
+}
+
+	/* 
+	 * PURPOSE: finds the matrix that owns the data of the given matrix or view
+	 * INPUT: 
+	 *	m - the matrix or view
+	 * RETURN:
+	 *  the parent of a view, the matrix itself otherwise, NULL for NULL
+	 */
+Matrix_t* matrix_root (Matrix_t* m) {
+	return m && m->parent ? m->parent : m;
+}
+
+	/* 
+	 * PURPOSE: copies the cached statistics of a matrix, dropping them if its data changed since
+	 * INPUT: 
+	 *	m - the matrix whoes statistics are copied
+	 * RETURN:
+	 *  the cached statistics, valid is 0 when none of them can be trusted
+	 */
+Matrix_Stats_t current_stats (Matrix_t* m) {
+
+	pthread_mutex_lock(&m->stats_lock);
+	Matrix_Stats_t stats = m->stats;
+	pthread_mutex_unlock(&m->stats_lock);
+	if (stats.version != matrix_root(m)->data_version) {
+		stats.valid = 0;
+	}
+	return stats;
+}
+
+	/* 
+	 * PURPOSE: records that the data of a matrix changed, which drops the statistics of every
+	 *  view sharing the data, and caches the statistics known for the new data
+	 * INPUT: 
+	 *	m - the matrix that was changed, the caller holds its write lock
+	 *	stats - the statistics of the new data, valid is 0 when none are known
+	 * RETURN:
+	 *
+	 */
+void set_stats (Matrix_t* m, const Matrix_Stats_t* stats) {
+
+	Matrix_t* root = matrix_root(m);
+	pthread_mutex_lock(&m->stats_lock);
+	root->data_version++;
+	m->stats = *stats;
+	m->stats.version = root->data_version;
+	pthread_mutex_unlock(&m->stats_lock);
+}
+
+	/* 
+	 * PURPOSE: checks if two matricies share some of their numbers without being the exact same block,
+	 *  which breaks element by element kernels that write one while reading the other
+	 * INPUT: 
+	 *	x - the first matrix or view
+	 *	y - the second matrix or view
+	 * RETURN:
+	 *  True - if the blocks of x and y intersect but differ
+	 *  Fasle - if they are separate or identical
+	 */
+bool partially_overlap (Matrix_t* x, Matrix_t* y) {
+
+	if (matrix_root(x) != matrix_root(y)) {
+		return false;
+	}
+	if (x->offset == y->offset && x->rows == y->rows && x->cols == y->cols) {
+		return false;
+	}
+	/* views of one matrix all share its stride so the offsets give the block corners */
+	const size_t stride = matrix_root(x)->stride ? matrix_root(x)->stride : 1;
+	const size_t x_row = x->offset / stride, x_col = x->offset % stride;
+	const size_t y_row = y->offset / stride, y_col = y->offset % stride;
+	return x_row < y_row + y->rows && y_row < x_row + x->rows
+		&& x_col < y_col + y->cols && y_col < x_col + x->cols;
+}
+
+	/* 
+	 * PURPOSE: works out the number of bytes of data in a matrix without overflowing
+	 * INPUT: 
+	 *	rows - the number of rows
+	 *	cols - the number of cols
+	 *	bytes - where the number of bytes is stored
+	 * RETURN:
+	 *  True - if the size fits in a size_t
+	 *  Fasle - if rows * cols * sizeof(unsigned int) overflows
+	 */
+bool matrix_bytes (uint64_t rows, uint64_t cols, size_t* bytes) {
+
+	size_t count = 0;
+	if (__builtin_mul_overflow(rows, cols, &count)
+		|| __builtin_mul_overflow(count, sizeof(unsigned int), bytes)) {
+		return false;
+	}
+	return true;
+}
+
+	/* 
+	 * PURPOSE: prints a file error message followed by the reason from errno
+	 * INPUT: 
+	 *	message - what failed
+	 * RETURN:
+	 *
+	 */
+void print_file_error (const char* message) {
+
+	report("%s", message);
+	if (errno == EACCES ) {
+		report("DO NOT HAVE ACCESS TO FILE: %s\n", strerror(errno));
+	}
+	else if (errno == EADDRINUSE ){
+		report("FILE ALREADY IN USE: %s\n", strerror(errno));
+	}
+	else if (errno == EBADF) {
+		report("BAD FILE DESCRIPTOR: %s\n", strerror(errno));	
+	}
+	else if (errno == EEXIST) {
+		report("FILE EXISTS: %s\n", strerror(errno));
+	}
+	else if (errno) {
+		report("%s\n", strerror(errno));
+	}
+}
+
+	/* 
+	 * PURPOSE: runs a multi matrix kernel over the rows, split over threads when there is enough work
+	 * INPUT: 
+	 *	work - the kernel, called with a Row_Band_t
+	 *	job - the arguments of the kernel, the rows are filled in per thread
+	 *	rows - the number of rows to split
+	 *	elements - the number of numbers the kernel reads, small jobs run on the calling thread
+	 * RETURN:
+	 *  the total of the sums the bands worked out
+	 */
+unsigned long long run_row_bands (void* (*work)(void*), const Row_Band_t* job, unsigned int rows, size_t elements) {
+
+	long cpus = sysconf(_SC_NPROCESSORS_ONLN);
+	unsigned int threads = elements < PARALLEL_THRESHOLD || cpus < 1 ? 1 : cpus;
+	if (threads > MAX_THREADS) {
+		threads = MAX_THREADS;
+	}
+	if (threads > rows) {
+		threads = rows ? rows : 1;
+	}
+
+	Row_Band_t bands[MAX_THREADS];
+	pthread_t ids[MAX_THREADS];
+	bool started[MAX_THREADS] = {false};
+	for (unsigned int t = 0; t < threads; ++t) {
+		bands[t] = *job;
+		bands[t].row_start = (unsigned long long)rows * t / threads;
+		bands[t].row_end = (unsigned long long)rows * (t + 1) / threads;
+		bands[t].sum = 0;
+		/* the calling thread takes the first band itself */
+		if (t > 0) {
+			started[t] = pthread_create(&ids[t], NULL, work, &bands[t]) == 0;
+		}
+	}
+	work(&bands[0]);
+
+	unsigned long long sum = bands[0].sum;
+	for (unsigned int t = 1; t < threads; ++t) {
+		if (started[t]) {
+			pthread_join(ids[t], NULL);
+		}
+		else {
+			work(&bands[t]);
+		}
+		sum += bands[t].sum;
+	}
+	return sum;
+}
+
+	/* 
+	 * PURPOSE: the reduce_matrices kernel, folds every input into a tile of the result kept on the stack
+	 * INPUT: 
+	 *	arg - the Row_Band_t to work on
+	 * RETURN:
+	 *  NULL
+	 */
+void* reduce_band (void* arg) {
+
+	Row_Band_t* band = arg;
+	Matrix_t* result = band->result;
+	unsigned int tile[TILE_COLS];
+	for (unsigned int i = band->row_start; i < band->row_end; ++i) {
+		for (unsigned int j0 = 0; j0 < result->cols; j0 += TILE_COLS) {
+			const unsigned int width = result->cols - j0 < TILE_COLS ? result->cols - j0 : TILE_COLS;
+			memcpy(tile, &band->ms[0]->data[(size_t)i * band->ms[0]->stride + j0], width * sizeof(unsigned int));
+			for (unsigned int k = 1; k < band->n; ++k) {
+				const unsigned int* row = &band->ms[k]->data[(size_t)i * band->ms[k]->stride + j0];
+				if (band->op == REDUCE_ADD) {
+					for (unsigned int j = 0; j < width; ++j) {
+						tile[j] += row[j];
+					}
+				}
+				else if (band->op == REDUCE_MAX) {
+					for (unsigned int j = 0; j < width; ++j) {
+						tile[j] = row[j] > tile[j] ? row[j] : tile[j];
+					}
+				}
+				else {
+					for (unsigned int j = 0; j < width; ++j) {
+						tile[j] = row[j] < tile[j] ? row[j] : tile[j];
+					}
+				}
+			}
+			memcpy(&result->data[(size_t)i * result->stride + j0], tile, width * sizeof(unsigned int));
+		}
+	}
+	return NULL;
+}
+
+	/* 
+	 * PURPOSE: the sum_all_matrices kernel, sums the band of its one matrix
+	 * INPUT: 
+	 *	arg - the Row_Band_t to work on
+	 * RETURN:
+	 *  NULL
+	 */
+void* sum_band (void* arg) {
+
+	Row_Band_t* band = arg;
+	const Matrix_t* m = band->ms[0];
+	unsigned long long sum = 0;
+	for (unsigned int i = band->row_start; i < band->row_end; ++i) {
+		const unsigned int* row = &m->data[(size_t)i * m->stride];
+		for (unsigned int j = 0; j < m->cols; ++j) {
+			sum += row[j];
+		}
+	}
+	band->sum = sum;
+	return NULL;
+}
+
+	/* 
+	 * PURPOSE: the broadcast_add_matrix kernel
+	 * INPUT: 
+	 *	arg - the Row_Band_t to work on
+	 * RETURN:
+	 *  NULL
+	 */
+void* broadcast_band (void* arg) {
+
+	Row_Band_t* band = arg;
+	const Matrix_t* a = band->ms[0];
+	const Matrix_t* vector = band->vector;
+	Matrix_t* result = band->result;
+	const bool row_vector = vector->rows == 1 && vector->cols == a->cols;
+	for (unsigned int i = band->row_start; i < band->row_end; ++i) {
+		const unsigned int* a_row = &a->data[(size_t)i * a->stride];
+		unsigned int* result_row = &result->data[(size_t)i * result->stride];
+		if (row_vector) {
+			for (unsigned int j = 0; j < a->cols; ++j) {
+				result_row[j] = a_row[j] + vector->data[j];
+			}
+		}
+		else {
+			const unsigned int value = vector->data[(size_t)i * vector->stride];
+			for (unsigned int j = 0; j < a->cols; ++j) {
+				result_row[j] = a_row[j] + value;
+			}
+		}
+	}
+	return NULL;
+}
+
+	/* 
+	 * PURPOSE: the read_matrices threads, each takes the next file nobody has started on until none are left
+	 * INPUT: 
+	 *	arg - the Read_Job_t to work on
+	 * RETURN:
+	 *  NULL
+	 */
+void* read_worker (void* arg) {
+
+	Read_Job_t* job = arg;
+	set_report_stream(job->out);
+	pthread_mutex_lock(&job->lock);
+	while (job->next < job->n) {
+		const unsigned int i = job->next++;
+		pthread_mutex_unlock(&job->lock);
+		struct stat st;
+		const size_t size = stat(job->filenames[i], &st) == 0 ? st.st_size : 0;
+
+		/* 
+		 * matricies that are not in the array yet cannot be spilled, so the files being read fit the
+		 * budget together; files start in order and the oldest one always goes ahead, since every
+		 * matrix before it can be spilled by then
+		 */
+		pthread_mutex_lock(&job->lock);
+		while (i != job->next_start
+			|| (job->budget && i != job->next_add && job->in_flight + size > job->budget)) {
+			pthread_cond_wait(&job->room, &job->lock);
+		}
+		job->next_start++;
+		job->in_flight += size;
+		job->files[i].bytes = size;
+		pthread_cond_broadcast(&job->room);
+		pthread_mutex_unlock(&job->lock);
+
+		Matrix_t* m = NULL;
+		if (!read_matrix(job->filenames[i], &m)) {
+			m = NULL;
+		}
+
+		pthread_mutex_lock(&job->lock);
+		job->files[i].m = m;
+		job->files[i].done = true;
+		if (m) {
+			job->bytes += m->mem_bytes;
+		}
+		add_read_matrices(job);
+	}
+	pthread_mutex_unlock(&job->lock);
+	return NULL;
+}
+
+	/* 
+	 * PURPOSE: adds the matricies read so far to the mats array, stopping at the first file still
+	 *  being read, the caller holds job->lock
+	 * INPUT: 
+	 *	job - the Read_Job_t whoes matricies are added
+	 * RETURN:
+	 *
+	 */
+void add_read_matrices (Read_Job_t* job) {
+
+	while (job->next_add < job->n && job->files[job->next_add].done) {
+		Read_File_t* file = &job->files[job->next_add];
+		if (!file->m) {
+			report("Failed to read %s\n", job->filenames[job->next_add]);
+		}
+		else if (add_matrix_to_array(job->mats, file->m, job->num_mats) == MATRIX_ARRAY_ERROR) {
+			report("Failed to add matrix (%s) to matrix array.\n", file->m->name);
+			destroy_matrix(&file->m);
+		}
+		else {
+			job->added++;
+			/* the files still to come may spill this one */
+			next_command_epoch();
+		}
+		job->in_flight -= file->bytes;
+		job->next_add++;
+	}
+	pthread_cond_broadcast(&job->room);
+}
@@ -1,27 +1,93 @@
 #ifndef _MATRIX_H_
 #define _MATRIX_H_
 
+#include <stdio.h>
+#include <pthread.h>
+
 #define MATRIX_NAME_LEN 25
+#define MATRIX_ARRAY_ERROR ((unsigned int)-1)
+
+/* histogram bin i counts the numbers whose highest set bit is bit i - 1, bin 0 counts zeros */
+#define MATRIX_HIST_BINS 33
+
+#define STATS_SUM 0x1
+#define STATS_MINMAX 0x2
+#define STATS_HIST 0x4
+#define STATS_ALL (STATS_SUM | STATS_MINMAX | STATS_HIST)
 
 typedef struct {
+	unsigned int valid;
+	unsigned long version;
+	unsigned long long sum;
+	unsigned int min;
+	unsigned int max;
+	unsigned long long hist[MATRIX_HIST_BINS];
+}Matrix_Stats_t;
+
+typedef enum {
+	REDUCE_ADD,
+	REDUCE_MAX,
+	REDUCE_MIN
+}Reduce_Op_t;
+
+/* a view shares the data of its parent, row i starts at data[i * stride] */
+typedef struct Matrix {
 	char name[MATRIX_NAME_LEN];
 	unsigned int rows;
 	unsigned int cols;
+	unsigned int stride;
 	unsigned int *data;
+	size_t map_len;
+	size_t offset;
+	struct Matrix* parent;
+	unsigned int refs;
+	unsigned long data_version;
+	/* memory budget bookkeeping, see memory.c */
+	size_t mem_bytes;
+	bool tracked;
+	bool spilled;
+	bool spill_slot;
+	unsigned long long spill_offset;
+	unsigned long spill_version;
+	/* a matrix mapped from a workspace archive is mapped again instead of read from the scratch file */
+	bool mapped;
+	int map_fd;
+	unsigned long long map_offset;
+	unsigned long map_version;
+	unsigned long last_epoch;
+	struct Matrix* lru_prev;
+	struct Matrix* lru_next;
+	Matrix_Stats_t stats;
+	pthread_rwlock_t lock;
+	pthread_mutex_t stats_lock;
 }Matrix_t;
 
 bool create_matrix (Matrix_t** new_matrix, const char* name, const unsigned int rows, const unsigned int cols);
 void destroy_matrix (Matrix_t** m); 
+bool slice_matrix (Matrix_t** view, const char* name, Matrix_t* src, unsigned int row_start, unsigned int row_end,
+		unsigned int col_start, unsigned int col_end);
 bool write_matrix (const char* matrix_output_filename, Matrix_t* m);
 bool read_matrix (const char* matrix_input_filename, Matrix_t** m);
-int sum_matrix (Matrix_t* m);
+unsigned int read_matrices (const char** filenames, unsigned int n, Matrix_t** mats, unsigned int num_mats,
+		unsigned long long* bytes);
+unsigned long long sum_matrix (Matrix_t* m);
+bool matrix_stats (Matrix_t* m, Matrix_Stats_t* stats);
 bool add_matrices (Matrix_t* a, Matrix_t* b, Matrix_t* c); 
+bool reduce_matrices (Matrix_t** ms, unsigned int n, Reduce_Op_t op, Matrix_t* result);
+bool sum_all_matrices (Matrix_t** ms, unsigned int n, unsigned long long* sum);
+bool broadcast_add_matrix (Matrix_t* a, Matrix_t* vector, Matrix_t* result);
 bool bitwise_shift_matrix (Matrix_t* a, char direction, unsigned int shift);
 bool duplicate_matrix (Matrix_t* src, Matrix_t* dest);
 bool equal_matrices (Matrix_t* a, Matrix_t* b); 
-void display_matrix (Matrix_t* m); 
+void display_matrix (Matrix_t* m, FILE* out); 
 bool random_matrix(Matrix_t* m, unsigned int start_range, unsigned int end_range);
 unsigned int add_matrix_to_array (Matrix_t** mats, Matrix_t* new_matrix, unsigned int num_mats);
+bool save_workspace (const char* workspace_filename, Matrix_t** mats, unsigned int num_mats);
+int load_workspace (const char* workspace_filename, Matrix_t** mats, unsigned int num_mats);
+void lock_matrices (Matrix_t** ms, unsigned int n, Matrix_t* writer);
+void unlock_matrices (Matrix_t** ms, unsigned int n);
+void set_report_stream (FILE* out);
+void report (const char* format, ...) __attribute__((format(printf, 1, 2)));
 
 
 #endif
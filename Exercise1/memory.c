@@ -0,0 +1,746 @@
+#define _GNU_SOURCE
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <stdbool.h>
+#include <stdint.h>
+#include <limits.h>
+
+#include <fcntl.h>
+#include <unistd.h>
+#include <errno.h>
+#include <pthread.h>
+#include <sys/mman.h>
+
+#include "matrix.h"
+#include "memory.h"
+
+/* payloads at least this big are backed by huge pages */
+#define HUGE_PAGE_SIZE (2UL << 20)
+#define HUGE_PAGE_THRESHOLD (4 * HUGE_PAGE_SIZE)
+
+#define SPILL_ALIGN 4096
+/* released scratch slots past this many are only punched out of the file, not reused */
+#define MAX_FREE_SLOTS 1024
+#define COPY_CHUNK (1 << 20)
+
+/*
+ * Counting allocator for matrix data with a memory budget. Matrices in the
+ * mats array are kept on a least recently used list, when an allocation would
+ * go over the budget the coldest ones are written to a scratch file and freed
+ * until it fits, workspace mappings nobody changed are only unmapped since
+ * their archive still holds the data. Spilling only happens while the caller holds the mats array
+ * exclusively, so no other command can be using a spilled matrix.
+ */
+static pthread_mutex_t mem_lock = PTHREAD_MUTEX_INITIALIZER;
+static size_t mem_budget = 0;
+static size_t mem_in_use = 0;
+static unsigned long command_epoch = 0;
+static Matrix_t* lru_head = NULL;
+static Matrix_t* lru_tail = NULL;
+static unsigned int spilled_count = 0;
+static size_t spilled_bytes = 0;
+static char scratch_dir[PATH_MAX] = "";
+static int scratch_fd = -1;
+static unsigned long long scratch_end = 0;
+static unsigned long long scratch_free_bytes = 0;
+
+/* a released part of the scratch file, kept sorted by offset with neighbours merged */
+typedef struct {
+	unsigned long long offset;
+	unsigned long long len;
+}Scratch_Slot_t;
+
+static Scratch_Slot_t free_slots[MAX_FREE_SLOTS];
+static unsigned int num_free_slots = 0;
+
+/*protected functions*/
+unsigned int* map_matrix_data (size_t bytes, size_t* map_len);
+void unmap_matrix_data (unsigned int* data, size_t map_len);
+bool reserve_memory (size_t bytes);
+bool spill_matrix (Matrix_t* m);
+bool open_scratch (void);
+unsigned long long take_scratch_slot (unsigned long long len);
+void release_scratch_slot (unsigned long long offset, unsigned long long len);
+unsigned long long spill_slot_len (const Matrix_t* m);
+void lru_unlink (Matrix_t* m);
+void lru_append (Matrix_t* m);
+
+	/* 
+	 * PURPOSE: allocates zeroed data for a matrix and counts it against the memory budget,
+	 *  spilling the least recently used matrices when it would not fit
+	 * INPUT: 
+	 *	bytes - the number of bytes needed
+	 *	map_len - set to the length of the mapping, 0 when the data came from calloc
+	 * RETURN:
+	 *  the data, NULL if it could not be allocated or does not fit in the budget
+	 */
+unsigned int* alloc_matrix_data (size_t bytes, size_t* map_len) {
+
+	if (!reserve_matrix_data(bytes)) {
+		return NULL;
+	}
+
+	unsigned int* data = map_matrix_data(bytes, map_len);
+	if (!data) {
+		pthread_mutex_lock(&mem_lock);
+		mem_in_use -= bytes;
+		pthread_mutex_unlock(&mem_lock);
+	}
+	return data;
+}
+
+	/* 
+	 * PURPOSE: counts matrix data that was not allocated here, such as a workspace mapping, against the
+	 *  memory budget, spilling the least recently used matrices when it would not fit
+	 * INPUT: 
+	 *	bytes - the number of bytes to count, give them back with free_matrix_data
+	 * RETURN:
+	 *  True - if the bytes have been counted
+	 *  Fasle - if they do not fit in the budget
+	 */
+bool reserve_matrix_data (size_t bytes) {
+
+	pthread_mutex_lock(&mem_lock);
+	const bool reserved = reserve_memory(bytes);
+	pthread_mutex_unlock(&mem_lock);
+	if (!reserved) {
+		report("%zu BYTES DO NOT FIT IN THE MEMORY BUDGET\n", bytes);
+	}
+	return reserved;
+}
+
+	/* 
+	 * PURPOSE: frees matrix data and gives its bytes back to the memory budget
+	 * INPUT: 
+	 *	data - the data to free
+	 *	bytes - the number of bytes counted for it
+	 *	map_len - the length of the mapping, 0 if the data came from calloc
+	 * RETURN:
+	 *
+	 */
+void free_matrix_data (unsigned int* data, size_t bytes, size_t map_len) {
+
+	unmap_matrix_data(data, map_len);
+	pthread_mutex_lock(&mem_lock);
+	mem_in_use -= bytes;
+	pthread_mutex_unlock(&mem_lock);
+}
+
+	/* 
+	 * PURPOSE: makes a matrix that was added to the mats array a candidate for spilling
+	 * INPUT: 
+	 *	m - the matrix, views are ignored since they own no counted data
+	 * RETURN:
+	 *
+	 */
+void track_matrix (Matrix_t* m) {
+
+	if (!m || m->parent || m->mem_bytes == 0) {
+		return;
+	}
+	pthread_mutex_lock(&mem_lock);
+	if (!m->tracked) {
+		m->tracked = true;
+		m->last_epoch = command_epoch;
+		if (m->spilled) {
+			spilled_count++;
+			spilled_bytes += m->mem_bytes;
+		}
+		else {
+			lru_append(m);
+		}
+	}
+	pthread_mutex_unlock(&mem_lock);
+}
+
+	/* 
+	 * PURPOSE: stops a matrix that left the mats array from being spilled
+	 * INPUT: 
+	 *	m - the matrix
+	 * RETURN:
+	 *
+	 */
+void untrack_matrix (Matrix_t* m) {
+
+	if (!m) {
+		return;
+	}
+	pthread_mutex_lock(&mem_lock);
+	if (m->tracked) {
+		m->tracked = false;
+		if (m->spilled) {
+			spilled_count--;
+			spilled_bytes -= m->mem_bytes;
+		}
+		else {
+			lru_unlink(m);
+		}
+	}
+	/* a matrix leaving the array is about to be destroyed, its copy in the scratch file is no longer needed */
+	if (m->spill_slot) {
+		release_scratch_slot(m->spill_offset, spill_slot_len(m));
+		m->spill_slot = false;
+	}
+	pthread_mutex_unlock(&mem_lock);
+}
+
+	/* 
+	 * PURPOSE: marks a matrix as used by the current command so it is the last to be spilled
+	 * INPUT: 
+	 *	m - the matrix
+	 * RETURN:
+	 *
+	 */
+void touch_matrix (Matrix_t* m) {
+
+	if (!m) {
+		return;
+	}
+	pthread_mutex_lock(&mem_lock);
+	m->last_epoch = command_epoch;
+	if (m->tracked && !m->spilled) {
+		lru_unlink(m);
+		lru_append(m);
+	}
+	pthread_mutex_unlock(&mem_lock);
+}
+
+	/* 
+	 * PURPOSE: starts a new command, matrices touched from here on are not spilled until the next one
+	 * INPUT: 
+	 * RETURN:
+	 *
+	 */
+void next_command_epoch (void) {
+
+	pthread_mutex_lock(&mem_lock);
+	command_epoch++;
+	pthread_mutex_unlock(&mem_lock);
+}
+
+	/* 
+	 * PURPOSE: reads a spilled matrix back from the scratch file, the caller holds the mats array exclusively
+	 * INPUT: 
+	 *	m - the matrix
+	 * RETURN:
+	 *  True - if the matrix has its data in memory
+	 *  Fasle - if it does not fit in the budget or could not be read back
+	 */
+bool page_in_matrix (Matrix_t* m) {
+
+	if (!m) {
+		return false;
+	}
+	pthread_mutex_lock(&mem_lock);
+	m->last_epoch = command_epoch;
+	const bool reserved = !m->spilled || reserve_memory(m->mem_bytes);
+	pthread_mutex_unlock(&mem_lock);
+	if (!m->spilled) {
+		return true;
+	}
+	if (!reserved) {
+		report("MATRIX (%s) DOES NOT FIT IN THE MEMORY BUDGET\n", m->name);
+		return false;
+	}
+
+	size_t map_len = 0;
+	unsigned int* data = NULL;
+	if (m->mapped) {
+		data = mmap(NULL, m->mem_bytes, PROT_READ | PROT_WRITE, MAP_PRIVATE, m->map_fd, m->map_offset);
+		data = data == MAP_FAILED ? NULL : data;
+		map_len = m->mem_bytes;
+	}
+	else {
+		data = map_matrix_data(m->mem_bytes, &map_len);
+		if (data && !read_fully(scratch_fd, data, m->mem_bytes, m->spill_offset)) {
+			unmap_matrix_data(data, map_len);
+			data = NULL;
+		}
+	}
+	if (!data) {
+		report("FAILED TO READ MATRIX (%s) BACK FROM %s\n", m->name, m->mapped ? "ITS WORKSPACE" : "THE SCRATCH FILE");
+		pthread_mutex_lock(&mem_lock);
+		mem_in_use -= m->mem_bytes;
+		pthread_mutex_unlock(&mem_lock);
+		return false;
+	}
+
+	pthread_mutex_lock(&mem_lock);
+	m->data = data;
+	m->map_len = map_len;
+	m->spilled = false;
+	if (m->tracked) {
+		spilled_count--;
+		spilled_bytes -= m->mem_bytes;
+		lru_append(m);
+	}
+	pthread_mutex_unlock(&mem_lock);
+	return true;
+}
+
+	/* 
+	 * PURPOSE: copies the data of a spilled matrix from the scratch file, or its workspace, into another file
+	 * INPUT: 
+	 *	m - the spilled matrix
+	 *	fd - the file to copy into
+	 *	offset - where in fd the data goes
+	 * RETURN:
+	 *  True - if the whole matrix was copied
+	 *  Fasle - if there are errors in the process
+	 */
+bool copy_spilled_data (Matrix_t* m, int fd, unsigned long long offset) {
+
+	if (!m || !m->spilled) {
+		return false;
+	}
+	unsigned char* buffer = malloc(COPY_CHUNK);
+	if (!buffer) {
+		return false;
+	}
+	const int from_fd = m->mapped ? m->map_fd : scratch_fd;
+	const unsigned long long from = m->mapped ? m->map_offset : m->spill_offset;
+	bool ok = true;
+	for (size_t done = 0; ok && done < m->mem_bytes; done += COPY_CHUNK) {
+		const size_t bytes = m->mem_bytes - done < COPY_CHUNK ? m->mem_bytes - done : COPY_CHUNK;
+		ok = read_fully(from_fd, buffer, bytes, from + done)
+			&& write_fully(fd, buffer, bytes, offset + done);
+	}
+	free(buffer);
+	return ok;
+}
+
+	/* 
+	 * PURPOSE: sets the memory budget and spills matrices until the data in memory fits it
+	 * INPUT: 
+	 *	bytes - the most bytes of matrix data to keep in memory, 0 for no limit
+	 * RETURN:
+	 *
+	 */
+void set_memory_budget (size_t bytes) {
+
+	pthread_mutex_lock(&mem_lock);
+	mem_budget = bytes;
+	reserve_memory(0);
+	pthread_mutex_unlock(&mem_lock);
+}
+
+	/* 
+	 * PURPOSE: sets the directory the scratch file for spilled matrices is made in
+	 * INPUT: 
+	 *	dir - the directory, $TMPDIR or /tmp are used when this is never called
+	 * RETURN:
+	 *  True - if the directory is set
+	 *  Fasle - if the path is too long or the scratch file is already in use
+	 */
+bool set_scratch_dir (const char* dir) {
+
+	if (!dir || strlen(dir) + 1 > sizeof(scratch_dir)) {
+		return false;
+	}
+	pthread_mutex_lock(&mem_lock);
+	const bool unused = scratch_fd < 0;
+	if (unused) {
+		strcpy(scratch_dir, dir);
+	}
+	pthread_mutex_unlock(&mem_lock);
+	return unused;
+}
+
+	/* 
+	 * PURPOSE: reports how much of the memory budget is used and how much has been spilled
+	 * INPUT: 
+	 *	usage - where the numbers are stored
+	 * RETURN:
+	 *
+	 */
+void memory_usage (Memory_Usage_t* usage) {
+
+	if (!usage) {
+		return;
+	}
+	pthread_mutex_lock(&mem_lock);
+	usage->budget = mem_budget;
+	usage->in_use = mem_in_use;
+	usage->spilled = spilled_count;
+	usage->spilled_bytes = spilled_bytes;
+	usage->scratch_bytes = scratch_end - scratch_free_bytes;
+	usage->resident = 0;
+	for (Matrix_t* m = lru_head; m; m = m->lru_next) {
+		usage->resident++;
+	}
+	pthread_mutex_unlock(&mem_lock);
+}
+
+/*Protected Functions in C*/
+
+	/* 
+	 * PURPOSE: counts bytes against the budget, spilling the least recently used matrices to make room,
+	 *  the caller holds mem_lock
+	 * INPUT: 
+	 *	bytes - the number of bytes to count
+	 * RETURN:
+	 *  True - if the bytes fit and have been counted
+	 *  Fasle - if nothing more can be spilled and the bytes still do not fit
+	 */
+bool reserve_memory (size_t bytes) {
+
+	while (mem_budget && mem_in_use + bytes > mem_budget) {
+		/* views pin their parent and the operands of the current command are off limits */
+		Matrix_t* m = lru_head;
+		while (m && (m->refs > 1 || m->last_epoch == command_epoch || !spill_matrix(m))) {
+			m = m->lru_next;
+		}
+		if (!m) {
+			return false;
+		}
+	}
+	mem_in_use += bytes;
+	return true;
+}
+
+	/* 
+	 * PURPOSE: writes a matrix to the scratch file and frees its data, the caller holds mem_lock
+	 * INPUT: 
+	 *	m - the matrix to spill
+	 * RETURN:
+	 *  True - if the matrix has been spilled
+	 *  Fasle - if it is in use or could not be written
+	 */
+bool spill_matrix (Matrix_t* m) {
+
+	if (pthread_rwlock_trywrlock(&m->lock)) {
+		return false;
+	}
+
+	/* a mapping nobody wrote to still matches its archive and is simply mapped again later */
+	if (!m->mapped || m->map_version != m->data_version) {
+		if (!open_scratch()) {
+			pthread_rwlock_unlock(&m->lock);
+			return false;
+		}
+
+		/* every matrix keeps its slot in the scratch file, a copy that is still current is not written again */
+		const bool fresh = !m->spill_slot;
+		if (fresh) {
+			m->spill_offset = take_scratch_slot(spill_slot_len(m));
+			m->spill_slot = true;
+		}
+		if ((fresh || m->spill_version != m->data_version)
+			&& !write_fully(scratch_fd, m->data, m->mem_bytes, m->spill_offset)) {
+			report("FAILED TO SPILL MATRIX (%s)\n", m->name);
+			if (fresh) {
+				release_scratch_slot(m->spill_offset, spill_slot_len(m));
+			}
+			m->spill_slot = !fresh;
+			pthread_rwlock_unlock(&m->lock);
+			return false;
+		}
+		m->spill_version = m->data_version;
+		/* the changed numbers live in the scratch file from now on */
+		if (m->mapped) {
+			close(m->map_fd);
+			m->mapped = false;
+		}
+	}
+
+	unmap_matrix_data(m->data, m->map_len);
+	m->data = NULL;
+	m->map_len = 0;
+	m->spilled = true;
+	mem_in_use -= m->mem_bytes;
+	spilled_count++;
+	spilled_bytes += m->mem_bytes;
+	lru_unlink(m);
+	pthread_rwlock_unlock(&m->lock);
+	return true;
+}
+
+	/* 
+	 * PURPOSE: finds room in the scratch file for a spilled matrix, reusing released slots before
+	 *  growing the file, the caller holds mem_lock
+	 * INPUT: 
+	 *	len - the size of the slot
+	 * RETURN:
+	 *  the offset of the slot in the scratch file
+	 */
+unsigned long long take_scratch_slot (unsigned long long len) {
+
+	for (unsigned int i = 0; i < num_free_slots; ++i) {
+		if (free_slots[i].len < len) {
+			continue;
+		}
+		const unsigned long long offset = free_slots[i].offset;
+		free_slots[i].offset += len;
+		free_slots[i].len -= len;
+		scratch_free_bytes -= len;
+		if (free_slots[i].len == 0) {
+			memmove(&free_slots[i], &free_slots[i + 1], (num_free_slots - i - 1) * sizeof(Scratch_Slot_t));
+			num_free_slots--;
+		}
+		return offset;
+	}
+	const unsigned long long offset = scratch_end;
+	scratch_end += len;
+	return offset;
+}
+
+	/* 
+	 * PURPOSE: gives a slot of the scratch file back, its disk space is freed right away and the slot
+	 *  is reused by later spills, the caller holds mem_lock
+	 * INPUT: 
+	 *	offset - the offset of the slot
+	 *	len - the size of the slot
+	 * RETURN:
+	 *
+	 */
+void release_scratch_slot (unsigned long long offset, unsigned long long len) {
+
+	if (len == 0) {
+		return;
+	}
+	/* the last slot in the file just shortens it, the slots freed before it may follow */
+	if (offset + len == scratch_end) {
+		scratch_end = offset;
+		if (num_free_slots && free_slots[num_free_slots - 1].offset + free_slots[num_free_slots - 1].len == scratch_end) {
+			num_free_slots--;
+			scratch_end = free_slots[num_free_slots].offset;
+			scratch_free_bytes -= free_slots[num_free_slots].len;
+		}
+		if (ftruncate(scratch_fd, scratch_end)) {
+			/* the file only keeps some unused space at its end */
+		}
+		return;
+	}
+	fallocate(scratch_fd, FALLOC_FL_PUNCH_HOLE | FALLOC_FL_KEEP_SIZE, offset, len);
+
+	unsigned int i = 0;
+	while (i < num_free_slots && free_slots[i].offset < offset) {
+		++i;
+	}
+	const bool joins_before = i > 0 && free_slots[i - 1].offset + free_slots[i - 1].len == offset;
+	const bool joins_after = i < num_free_slots && offset + len == free_slots[i].offset;
+	if (joins_before && joins_after) {
+		free_slots[i - 1].len += len + free_slots[i].len;
+		memmove(&free_slots[i], &free_slots[i + 1], (num_free_slots - i - 1) * sizeof(Scratch_Slot_t));
+		num_free_slots--;
+	}
+	else if (joins_before) {
+		free_slots[i - 1].len += len;
+	}
+	else if (joins_after) {
+		free_slots[i].offset = offset;
+		free_slots[i].len += len;
+	}
+	else if (num_free_slots < MAX_FREE_SLOTS) {
+		memmove(&free_slots[i + 1], &free_slots[i], (num_free_slots - i) * sizeof(Scratch_Slot_t));
+		free_slots[i].offset = offset;
+		free_slots[i].len = len;
+		num_free_slots++;
+	}
+	else {
+		/* no room to remember it, the hole punched above still gives the disk space back */
+		return;
+	}
+	scratch_free_bytes += len;
+}
+
+	/* 
+	 * PURPOSE: gets the size of the scratch file slot of a matrix
+	 * INPUT: 
+	 *	m - the matrix
+	 * RETURN:
+	 *  its data size rounded up to SPILL_ALIGN
+	 */
+unsigned long long spill_slot_len (const Matrix_t* m) {
+
+	return (m->mem_bytes + SPILL_ALIGN - 1) / SPILL_ALIGN * SPILL_ALIGN;
+}
+
+	/* 
+	 * PURPOSE: creates the scratch file the first time something is spilled, it is unlinked right
+	 *  away so it disappears with the process
+	 * INPUT: 
+	 * RETURN:
+	 *  True - if the scratch file is open
+	 *  Fasle - if it could not be created
+	 */
+bool open_scratch (void) {
+
+	if (scratch_fd >= 0) {
+		return true;
+	}
+	const char* dir = scratch_dir[0] ? scratch_dir : getenv("TMPDIR");
+	char path[PATH_MAX];
+	if (snprintf(path, sizeof(path), "%s/matlab-spill-XXXXXX", dir && dir[0] ? dir : "/tmp") >= (int)sizeof(path)) {
+		report("SCRATCH DIRECTORY PATH IS TOO LONG\n");
+		return false;
+	}
+	scratch_fd = mkstemp(path);
+	if (scratch_fd < 0) {
+		report("FAILED TO CREATE SCRATCH FILE: %s\n", strerror(errno));
+		return false;
+	}
+	unlink(path);
+	return true;
+}
+
+	/* 
+	 * PURPOSE: removes a matrix from the least recently used list
+	 * INPUT: 
+	 *	m - the matrix
+	 * RETURN:
+	 *
+	 */
+void lru_unlink (Matrix_t* m) {
+
+	if (m->lru_prev) {
+		m->lru_prev->lru_next = m->lru_next;
+	}
+	else if (lru_head == m) {
+		lru_head = m->lru_next;
+	}
+	if (m->lru_next) {
+		m->lru_next->lru_prev = m->lru_prev;
+	}
+	else if (lru_tail == m) {
+		lru_tail = m->lru_prev;
+	}
+	m->lru_prev = NULL;
+	m->lru_next = NULL;
+}
+
+	/* 
+	 * PURPOSE: puts a matrix at the most recently used end of the list
+	 * INPUT: 
+	 *	m - the matrix
+	 * RETURN:
+	 *
+	 */
+void lru_append (Matrix_t* m) {
+
+	m->lru_prev = lru_tail;
+	m->lru_next = NULL;
+	if (lru_tail) {
+		lru_tail->lru_next = m;
+	}
+	else {
+		lru_head = m;
+	}
+	lru_tail = m;
+}
+
+	/* 
+	 * PURPOSE: allocates zeroed memory, large payloads are mapped on huge pages so
+	 *  walking them does not thrash the TLB
+	 * INPUT: 
+	 *	bytes - the number of bytes needed
+	 *	map_len - set to the length of the mapping, 0 when the data came from calloc
+	 * RETURN:
+	 *  the data, NULL if it could not be allocated
+	 */
+unsigned int* map_matrix_data (size_t bytes, size_t* map_len) {
+
+	*map_len = 0;
+	if (bytes < HUGE_PAGE_THRESHOLD) {
+		return calloc(bytes ? bytes : 1, 1);
+	}
+
+	const size_t len = (bytes + HUGE_PAGE_SIZE - 1) / HUGE_PAGE_SIZE * HUGE_PAGE_SIZE;
+	/* explicit huge pages only work when the admin reserved some, so this fails often */
+	void* data = mmap(NULL, len, PROT_READ | PROT_WRITE, MAP_PRIVATE | MAP_ANONYMOUS | MAP_HUGETLB, -1, 0);
+	if (data != MAP_FAILED) {
+		*map_len = len;
+		return data;
+	}
+
+	/* fall back to transparent huge pages, which need the mapping aligned to a huge page */
+	unsigned char* raw = mmap(NULL, len + HUGE_PAGE_SIZE, PROT_READ | PROT_WRITE, MAP_PRIVATE | MAP_ANONYMOUS, -1, 0);
+	if (raw == MAP_FAILED) {
+		return NULL;
+	}
+	unsigned char* aligned = (unsigned char*)(((uintptr_t)raw + HUGE_PAGE_SIZE - 1) & ~(HUGE_PAGE_SIZE - 1));
+	if (aligned > raw) {
+		munmap(raw, aligned - raw);
+	}
+	munmap(aligned + len, raw + HUGE_PAGE_SIZE - aligned);
+	madvise(aligned, len, MADV_HUGEPAGE);
+	*map_len = len;
+	return (unsigned int*)aligned;
+}
+
+	/* 
+	 * PURPOSE: frees memory from map_matrix_data or a workspace mapping
+	 * INPUT: 
+	 *	data - the data to free
+	 *	map_len - the length of the mapping, 0 if the data came from calloc
+	 * RETURN:
+	 *
+	 */
+void unmap_matrix_data (unsigned int* data, size_t map_len) {
+
+	if (map_len) {
+		munmap(data, map_len);
+	}
+	else {
+		free(data);
+	}
+}
+
+	/* 
+	 * PURPOSE: reads exactly the given number of bytes, a single read stops short of 2GB
+	 * INPUT: 
+	 *	fd - the file to read from
+	 *	buffer - where the bytes are stored
+	 *	bytes - the number of bytes to read
+	 *	offset - where in the file to start, FILE_CURSOR to read on from the current position
+	 * RETURN:
+	 *  True - if every byte was read
+	 *  Fasle - on an error or the end of the file
+	 */
+bool read_fully (int fd, void* buffer, size_t bytes, long long offset) {
+
+	unsigned char* next = buffer;
+	while (bytes > 0) {
+		ssize_t n = offset == FILE_CURSOR ? read(fd, next, bytes) : pread(fd, next, bytes, offset);
+		if (n < 0 && errno == EINTR) {
+			continue;
+		}
+		if (n <= 0) {
+			return false;
+		}
+		next += n;
+		offset += offset == FILE_CURSOR ? 0 : n;
+		bytes -= n;
+	}
+	return true;
+}
+
+	/* 
+	 * PURPOSE: writes exactly the given number of bytes, a single write stops short of 2GB
+	 * INPUT: 
+	 *	fd - the file to write to
+	 *	buffer - the bytes to write
+	 *	bytes - the number of bytes to write
+	 *	offset - where in the file to start, FILE_CURSOR to write on from the current position
+	 * RETURN:
+	 *  True - if every byte was written
+	 *  Fasle - on an error
+	 */
+bool write_fully (int fd, const void* buffer, size_t bytes, long long offset) {
+
+	const unsigned char* next = buffer;
+	while (bytes > 0) {
+		ssize_t n = offset == FILE_CURSOR ? write(fd, next, bytes) : pwrite(fd, next, bytes, offset);
+		if (n < 0 && errno == EINTR) {
+			continue;
+		}
+		if (n <= 0) {
+			return false;
+		}
+		next += n;
+		offset += offset == FILE_CURSOR ? 0 : n;
+		bytes -= n;
+	}
+	return true;
+}
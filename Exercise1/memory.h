@@ -0,0 +1,31 @@
+#ifndef _MEMORY_H_
+#define _MEMORY_H_
+
+/* the offset that makes read_fully and write_fully go on from the current file position */
+#define FILE_CURSOR -1LL
+
+typedef struct {
+	size_t budget;
+	size_t in_use;
+	size_t spilled_bytes;
+	size_t scratch_bytes;
+	unsigned int resident;
+	unsigned int spilled;
+}Memory_Usage_t;
+
+unsigned int* alloc_matrix_data (size_t bytes, size_t* map_len);
+bool reserve_matrix_data (size_t bytes);
+void free_matrix_data (unsigned int* data, size_t bytes, size_t map_len);
+void track_matrix (Matrix_t* m);
+void untrack_matrix (Matrix_t* m);
+void touch_matrix (Matrix_t* m);
+void next_command_epoch (void);
+bool page_in_matrix (Matrix_t* m);
+bool copy_spilled_data (Matrix_t* m, int fd, unsigned long long offset);
+void set_memory_budget (size_t bytes);
+bool set_scratch_dir (const char* dir);
+void memory_usage (Memory_Usage_t* usage);
+bool read_fully (int fd, void* buffer, size_t bytes, long long offset);
+bool write_fully (int fd, const void* buffer, size_t bytes, long long offset);
+
+#endif
@@ -0,0 +1,211 @@
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <stdbool.h>
+
+#include <errno.h>
+#include <signal.h>
+#include <unistd.h>
+#include <pthread.h>
+#include <sys/socket.h>
+#include <sys/un.h>
+
+#include "command.h"
+#include "matrix.h"
+#include "server.h"
+
+typedef struct {
+	pthread_t thread;
+	int fd;
+	bool started;
+	bool done;
+	Matrix_t** mats;
+	unsigned int num_mats;
+	Command_Handler_t handler;
+}Client_t;
+
+static volatile sig_atomic_t server_stop = 0;
+static pthread_mutex_t clients_lock = PTHREAD_MUTEX_INITIALIZER;
+
+/*protected functions*/
+void* serve_client (void* arg);
+void stop_server (int signum);
+
+	/* 
+	 * PURPOSE: serves the matrices to many clients over a unix domain socket until SIGINT or SIGTERM
+	 * INPUTS:
+	 *	socket_path - the filesystem path of the socket to listen on
+	 *	mats - the list of matrices shared by every client
+	 *	num_mats - the number of matrices in the list
+	 *	handler - runs one parsed command, must be safe to call from many threads at once
+	 * RETURN:
+	 *  True - if the server started and was shut down cleanly
+	 *  False - if the socket could not be set up
+	 */
+bool run_server (const char* socket_path, Matrix_t** mats, unsigned int num_mats, Command_Handler_t handler) {
+
+	if (!socket_path || !mats || !handler) {
+		return false;
+	}
+
+	struct sockaddr_un addr;
+	memset(&addr, 0, sizeof(addr));
+	addr.sun_family = AF_UNIX;
+	if (strlen(socket_path) + 1 > sizeof(addr.sun_path)) {
+		printf("Socket path (%s) is too long\n", socket_path);
+		return false;
+	}
+	strncpy(addr.sun_path, socket_path, sizeof(addr.sun_path) - 1);
+
+	int listen_fd = socket(AF_UNIX, SOCK_STREAM, 0);
+	if (listen_fd < 0) {
+		perror("FAILED TO CREATE SOCKET\n");
+		return false;
+	}
+	unlink(socket_path);
+	if (bind(listen_fd, (struct sockaddr*)&addr, sizeof(addr)) || listen(listen_fd, MAX_CLIENTS)) {
+		perror("FAILED TO LISTEN ON SOCKET\n");
+		close(listen_fd);
+		return false;
+	}
+
+	/* no SA_RESTART so a signal breaks accept out of its wait */
+	struct sigaction sa;
+	memset(&sa, 0, sizeof(sa));
+	sa.sa_handler = stop_server;
+	sigemptyset(&sa.sa_mask);
+	sigaction(SIGINT, &sa, NULL);
+	sigaction(SIGTERM, &sa, NULL);
+	signal(SIGPIPE, SIG_IGN);
+
+	Client_t clients[MAX_CLIENTS];
+	memset(clients, 0, sizeof(clients));
+
+	printf("Serving matrices on %s\n", socket_path);
+	while (!server_stop) {
+		int fd = accept(listen_fd, NULL, NULL);
+		if (fd < 0) {
+			if (errno != EINTR) {
+				perror("FAILED TO ACCEPT CLIENT\n");
+			}
+			continue;
+		}
+
+		/* reuse the first slot that is free or whose client has hung up */
+		Client_t* slot = NULL;
+		for (unsigned int i = 0; i < MAX_CLIENTS && !slot; ++i) {
+			pthread_mutex_lock(&clients_lock);
+			const bool reusable = !clients[i].started || clients[i].done;
+			pthread_mutex_unlock(&clients_lock);
+			if (reusable) {
+				if (clients[i].started) {
+					pthread_join(clients[i].thread, NULL);
+				}
+				slot = &clients[i];
+			}
+		}
+		if (!slot) {
+			const char busy[] = "Too many clients\n";
+			if (write(fd, busy, sizeof(busy)) < 0) {
+				perror("FAILED TO REJECT CLIENT\n");
+			}
+			close(fd);
+			continue;
+		}
+
+		memset(slot, 0, sizeof(*slot));
+		slot->fd = fd;
+		slot->mats = mats;
+		slot->num_mats = num_mats;
+		slot->handler = handler;
+		if (pthread_create(&slot->thread, NULL, serve_client, slot)) {
+			perror("FAILED TO START CLIENT THREAD\n");
+			close(fd);
+			continue;
+		}
+		slot->started = true;
+	}
+
+	/* wake up every client still waiting on input and wait for them to finish */
+	for (unsigned int i = 0; i < MAX_CLIENTS; ++i) {
+		if (clients[i].started) {
+			pthread_mutex_lock(&clients_lock);
+			if (!clients[i].done) {
+				shutdown(clients[i].fd, SHUT_RDWR);
+			}
+			pthread_mutex_unlock(&clients_lock);
+			pthread_join(clients[i].thread, NULL);
+		}
+	}
+	close(listen_fd);
+	unlink(socket_path);
+	printf("Server on %s shut down\n", socket_path);
+	return true;
+}
+
+/*Protected Functions in C*/
+
+	/* 
+	 * PURPOSE: runs the commands of one client, each reply is terminated by a NUL byte
+	 * INPUT: 
+	 *	arg - the Client_t slot of the connection
+	 * RETURN:
+	 *  NULL
+	 */
+void* serve_client (void* arg) {
+
+	Client_t* client = arg;
+	FILE* in = fdopen(dup(client->fd), "r");
+	FILE* out = fdopen(dup(client->fd), "w");
+	char* line = NULL;
+	size_t line_cap = 0;
+
+	while (in && out && getline(&line, &line_cap, in) > 0) {
+		Commands_t* cmd = NULL;
+		/* run_commands gives the stream back when it is done, so parse errors need it set again */
+		set_report_stream(out);
+		if (!parse_user_input(line, &cmd)) {
+			fprintf(out, "Failed at parsing command\n\n");
+		}
+		else if (cmd->num_cmds > 0 && strcmp(cmd->cmds[0], "exit") == 0) {
+			destroy_commands(&cmd);
+			break;
+		}
+		else if (cmd->num_cmds > 0) {
+			client->handler(cmd, client->mats, client->num_mats, out);
+		}
+		if (cmd) {
+			destroy_commands(&cmd);
+		}
+		fputc('\0', out);
+		if (fflush(out)) {
+			break;
+		}
+	}
+
+	free(line);
+	set_report_stream(NULL);
+	if (in) {
+		fclose(in);
+	}
+	if (out) {
+		fclose(out);
+	}
+	pthread_mutex_lock(&clients_lock);
+	close(client->fd);
+	client->done = true;
+	pthread_mutex_unlock(&clients_lock);
+	return NULL;
+}
+
+	/* 
+	 * PURPOSE: signal handler that asks the accept loop to stop
+	 * INPUT: 
+	 *	signum - the signal that was caught
+	 * RETURN:
+	 *
+	 */
+void stop_server (int signum) {
+	(void)signum;
+	server_stop = 1;
+}
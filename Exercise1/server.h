@@ -0,0 +1,10 @@
+#ifndef _SERVER_H_
+#define _SERVER_H_
+
+#define MAX_CLIENTS 64
+
+typedef void (*Command_Handler_t)(Commands_t* cmd, Matrix_t** mats, unsigned int num_mats, FILE* out);
+
+bool run_server (const char* socket_path, Matrix_t** mats, unsigned int num_mats, Command_Handler_t handler);
+
+#endif
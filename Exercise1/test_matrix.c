@@ -0,0 +1,716 @@
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <stdbool.h>
+
+#include <stdint.h>
+#include <time.h>
+#include <unistd.h>
+
+#include "matrix.h"
+
+/* shapes that are not a multiple of any vector width, plus ones that cross the tile and thread thresholds */
+static const unsigned int sizes[] = {1, 2, 3, 5, 7, 8, 9, 15, 16, 17, 31, 33, 63, 64, 65, 127, 1023, 1025};
+#define NUM_SIZES (sizeof(sizes) / sizeof(sizes[0]))
+#define NUM_ROUNDS 40
+#define MAX_OPERANDS 5
+
+/* the perf gate fails a kernel that is this many times slower than the stored baseline */
+#define PERF_TOLERANCE 3.0
+#define PERF_SIZE 2048
+#define PERF_RUNS 5
+/* timings this close to the baseline pass however small the baseline is */
+#define PERF_SLACK_USEC 100
+
+typedef struct {
+	const char* name;
+	double usec;
+}Perf_Result_t;
+
+static unsigned int checks = 0;
+static unsigned int failures = 0;
+
+/*protected functions*/
+Matrix_t* new_operand (unsigned int rows, unsigned int cols, bool view);
+unsigned int* flatten (Matrix_t* m);
+void check (bool passed, const char* kernel, Matrix_t* m, const char* what);
+void check_data (const char* kernel, Matrix_t* m, const unsigned int* expected);
+void check_stats (const char* kernel, Matrix_t* m);
+void random_shape (unsigned int* rows, unsigned int* cols);
+void test_add (unsigned int rows, unsigned int cols);
+void test_reduce (unsigned int rows, unsigned int cols);
+void test_broadcast (unsigned int rows, unsigned int cols);
+void test_shift (unsigned int rows, unsigned int cols);
+void test_duplicate (unsigned int rows, unsigned int cols);
+void test_file (unsigned int rows, unsigned int cols, const char* dir);
+void test_workspace (unsigned int rows, unsigned int cols, const char* dir);
+unsigned int run_perf (Perf_Result_t* results);
+double time_kernel (unsigned int kernel, Matrix_t** ms, Matrix_t* vector);
+bool perf_gate (const char* baseline_file, bool write_baseline);
+
+   	/*
+	 * PURPOSE: checks every kernel in matrix.c against a simple scalar version of it on random
+	 *  shapes, then times the kernels against a stored baseline
+	 * INPUT:
+	 *	argc - the number of arguments
+	 *	argv - -s <seed> picks the random seed, -p <file> checks the timings against a baseline
+	 *	 and -w <file> writes a new baseline
+	 * RETURN:
+	 *  0 - if every check passed
+	 *  1 - if a kernel gave a different answer or got slower
+	 */
+int main (int argc, char **argv) {
+
+	unsigned int seed = time(NULL);
+	const char* baseline_file = NULL;
+	bool write_baseline = false;
+	int opt;
+	while ((opt = getopt(argc, argv, "s:p:w:")) != -1) {
+		switch (opt) {
+			case 's':
+				seed = strtoul(optarg, NULL, 10);
+				break;
+			case 'p':
+			case 'w':
+				baseline_file = optarg;
+				write_baseline = opt == 'w';
+				break;
+			default:
+				printf("usage: %s [-s seed] [-p baseline_file | -w baseline_file]\n", argv[0]);
+				return 1;
+		}
+	}
+	printf("Checking the kernels with seed %u\n", seed);
+	srand(seed);
+
+	char dir[] = "/tmp/test_matrix_XXXXXX";
+	if (!mkdtemp(dir)) {
+		perror("FAILED TO MAKE A TEMPORARY DIRECTORY");
+		return 1;
+	}
+
+	for (unsigned int round = 0; round < NUM_ROUNDS; ++round) {
+		unsigned int rows, cols;
+		random_shape(&rows, &cols);
+		test_add(rows, cols);
+		test_reduce(rows, cols);
+		test_broadcast(rows, cols);
+		test_shift(rows, cols);
+		test_duplicate(rows, cols);
+		test_file(rows, cols, dir);
+	}
+	/* big enough to be split over threads, with a last tile that is not full */
+	test_reduce(517, 1031);
+	test_broadcast(517, 1031);
+	test_workspace(33, 65, dir);
+	rmdir(dir);
+
+	printf("%u checks, %u failures\n", checks, failures);
+	if (failures) {
+		printf("Rerun with -s %u to repeat them\n", seed);
+		return 1;
+	}
+	if (baseline_file && !perf_gate(baseline_file, write_baseline)) {
+		return 1;
+	}
+	return 0;
+}
+
+/*Protected Functions in C*/
+
+	/*
+	 * PURPOSE: makes a matrix of random numbers to test with
+	 * INPUT:
+	 *	rows - the number of rows
+	 *	cols - the number of cols
+	 *	view - makes a view into the middle of a bigger matrix instead, so rows do not follow each other
+	 * RETURN:
+	 *  the matrix, the program exits if it could not be made
+	 */
+Matrix_t* new_operand (unsigned int rows, unsigned int cols, bool view) {
+
+	/* small numbers, numbers that overflow when added and everything rand gives */
+	static const unsigned int ranges[][2] = {{0, 9}, {0, 1U << 20}, {UINT32_MAX - (1U << 30), UINT32_MAX}, {0, UINT32_MAX}};
+	const unsigned int range = rand() % 4;
+
+	Matrix_t* m = NULL;
+	if (!create_matrix(&m, "operand", rows + (view ? 3 : 0), cols + (view ? 5 : 0))) {
+		printf("FAILED TO CREATE A %u x %u MATRIX\n", rows, cols);
+		exit(1);
+	}
+	random_matrix(m, ranges[range][0], ranges[range][1]);
+	if (view) {
+		Matrix_t* block = NULL;
+		if (!slice_matrix(&block, "view", m, 1, rows + 1, 2, cols + 2)) {
+			exit(1);
+		}
+		/* the view keeps the data alive */
+		destroy_matrix(&m);
+		m = block;
+	}
+	return m;
+}
+
+	/*
+	 * PURPOSE: copies the numbers of a matrix into an array with no gaps between the rows
+	 * INPUT:
+	 *	m - the matrix
+	 * RETURN:
+	 *  the array, free it with free
+	 */
+unsigned int* flatten (Matrix_t* m) {
+
+	unsigned int* flat = malloc((size_t)m->rows * m->cols * sizeof(unsigned int) + 1);
+	if (!flat) {
+		exit(1);
+	}
+	for (unsigned int i = 0; i < m->rows; ++i) {
+		for (unsigned int j = 0; j < m->cols; ++j) {
+			flat[(size_t)i * m->cols + j] = m->data[(size_t)i * m->stride + j];
+		}
+	}
+	return flat;
+}
+
+	/*
+	 * PURPOSE: counts a check and reports it if it failed
+	 * INPUT:
+	 *	passed - the result of the check
+	 *	kernel - the kernel being checked
+	 *	m - the matrix the kernel gave
+	 *	what - what was checked
+	 * RETURN:
+	 *
+	 */
+void check (bool passed, const char* kernel, Matrix_t* m, const char* what) {
+
+	checks++;
+	if (!passed) {
+		failures++;
+		printf("FAIL %s on a %u x %u %s: %s\n", kernel, m->rows, m->cols, m->parent ? "view" : "matrix", what);
+	}
+}
+
+	/*
+	 * PURPOSE: checks the numbers of a matrix against the ones the scalar version worked out
+	 * INPUT:
+	 *	kernel - the kernel being checked
+	 *	m - the matrix the kernel gave
+	 *	expected - the numbers the scalar version gave, rows after each other
+	 * RETURN:
+	 *
+	 */
+void check_data (const char* kernel, Matrix_t* m, const unsigned int* expected) {
+
+	bool same = true;
+	for (unsigned int i = 0; i < m->rows && same; ++i) {
+		same = memcmp(&m->data[(size_t)i * m->stride], &expected[(size_t)i * m->cols],
+			m->cols * sizeof(unsigned int)) == 0;
+	}
+	check(same, kernel, m, "the numbers differ");
+}
+
+	/*
+	 * PURPOSE: checks the statistics a kernel left cached with a matrix against a scalar pass over it
+	 * INPUT:
+	 *	kernel - the kernel being checked
+	 *	m - the matrix the kernel gave
+	 * RETURN:
+	 *
+	 */
+void check_stats (const char* kernel, Matrix_t* m) {
+
+	Matrix_Stats_t expected;
+	memset(&expected, 0, sizeof(expected));
+	expected.min = UINT32_MAX;
+	for (unsigned int i = 0; i < m->rows; ++i) {
+		for (unsigned int j = 0; j < m->cols; ++j) {
+			const unsigned int value = m->data[(size_t)i * m->stride + j];
+			unsigned int bin = 0;
+			while (bin < 32 && value >> bin) {
+				bin++;
+			}
+			expected.sum += value;
+			expected.min = value < expected.min ? value : expected.min;
+			expected.max = value > expected.max ? value : expected.max;
+			expected.hist[bin]++;
+		}
+	}
+
+	Matrix_Stats_t stats;
+	check(matrix_stats(m, &stats), kernel, m, "matrix_stats failed");
+	check(stats.sum == expected.sum, kernel, m, "the cached sum is wrong");
+	check(stats.min == expected.min && stats.max == expected.max, kernel, m, "the cached min or max is wrong");
+	check(memcmp(stats.hist, expected.hist, sizeof(expected.hist)) == 0, kernel, m, "the cached histogram is wrong");
+
+	unsigned long long sum = 0;
+	check(sum_all_matrices(&m, 1, &sum) && sum == expected.sum, kernel, m, "sum_all_matrices is wrong");
+}
+
+	/*
+	 * PURPOSE: picks the shape of the next round, a tenth of them are a single row or column
+	 * INPUT:
+	 *	rows - set to the number of rows
+	 *	cols - set to the number of cols
+	 * RETURN:
+	 *
+	 */
+void random_shape (unsigned int* rows, unsigned int* cols) {
+
+	*rows = sizes[rand() % NUM_SIZES];
+	*cols = sizes[rand() % NUM_SIZES];
+	switch (rand() % 10) {
+		case 0:
+			*rows = 1;
+			break;
+		case 1:
+			*cols = 1;
+			break;
+	}
+}
+
+	/*
+	 * PURPOSE: checks add_matrices into a new matrix and in place
+	 * INPUT:
+	 *	rows - the number of rows to test with
+	 *	cols - the number of cols to test with
+	 * RETURN:
+	 *
+	 */
+void test_add (unsigned int rows, unsigned int cols) {
+
+	Matrix_t* a = new_operand(rows, cols, rand() % 2);
+	Matrix_t* b = new_operand(rows, cols, rand() % 2);
+	Matrix_t* c = new_operand(rows, cols, rand() % 2);
+	/* with cached statistics on the inputs add works out the sum of the result from them */
+	if (rand() % 2) {
+		sum_matrix(a);
+		sum_matrix(b);
+	}
+	unsigned int* fa = flatten(a);
+	unsigned int* fb = flatten(b);
+	for (size_t k = 0; k < (size_t)rows * cols; ++k) {
+		fa[k] += fb[k];
+	}
+
+	check(add_matrices(a, b, c), "add_matrices", c, "returned false");
+	check_data("add_matrices", c, fa);
+	check_stats("add_matrices", c);
+	check(add_matrices(a, b, a), "add_matrices in place", a, "returned false");
+	check_data("add_matrices in place", a, fa);
+	check_stats("add_matrices in place", a);
+
+	free(fa);
+	free(fb);
+	destroy_matrix(&a);
+	destroy_matrix(&b);
+	destroy_matrix(&c);
+}
+
+	/*
+	 * PURPOSE: checks reduce_matrices with every op on a random number of inputs, the result
+	 *  being one of the inputs half the time
+	 * INPUT:
+	 *	rows - the number of rows to test with
+	 *	cols - the number of cols to test with
+	 * RETURN:
+	 *
+	 */
+void test_reduce (unsigned int rows, unsigned int cols) {
+
+	static const char* kernels[] = {"reduce_matrices add", "reduce_matrices max", "reduce_matrices min"};
+	for (Reduce_Op_t op = REDUCE_ADD; op <= REDUCE_MIN; ++op) {
+		const unsigned int n = rand() % MAX_OPERANDS + 1;
+		Matrix_t* ms[MAX_OPERANDS];
+		for (unsigned int k = 0; k < n; ++k) {
+			ms[k] = new_operand(rows, cols, rand() % 2);
+			if (rand() % 2) {
+				sum_matrix(ms[k]);
+			}
+		}
+
+		unsigned int* expected = flatten(ms[0]);
+		for (unsigned int k = 1; k < n; ++k) {
+			unsigned int* fk = flatten(ms[k]);
+			for (size_t e = 0; e < (size_t)rows * cols; ++e) {
+				if (op == REDUCE_ADD) {
+					expected[e] += fk[e];
+				}
+				else if (op == REDUCE_MAX) {
+					expected[e] = fk[e] > expected[e] ? fk[e] : expected[e];
+				}
+				else {
+					expected[e] = fk[e] < expected[e] ? fk[e] : expected[e];
+				}
+			}
+			free(fk);
+		}
+
+		unsigned long long sum = 0;
+		unsigned long long expected_sum = 0;
+		for (unsigned int k = 0; k < n; ++k) {
+			unsigned int* fk = flatten(ms[k]);
+			for (size_t e = 0; e < (size_t)rows * cols; ++e) {
+				expected_sum += fk[e];
+			}
+			free(fk);
+		}
+		check(sum_all_matrices(ms, n, &sum) && sum == expected_sum, "sum_all_matrices", ms[0], "the total is wrong");
+
+		const bool in_place = rand() % 2;
+		Matrix_t* result = in_place ? ms[0] : new_operand(rows, cols, rand() % 2);
+		check(reduce_matrices(ms, n, op, result), kernels[op], result, "returned false");
+		check_data(kernels[op], result, expected);
+		check_stats(kernels[op], result);
+
+		free(expected);
+		if (!in_place) {
+			destroy_matrix(&result);
+		}
+		for (unsigned int k = 0; k < n; ++k) {
+			destroy_matrix(&ms[k]);
+		}
+	}
+}
+
+	/*
+	 * PURPOSE: checks broadcast_add_matrix with a row vector and a column vector
+	 * INPUT:
+	 *	rows - the number of rows to test with
+	 *	cols - the number of cols to test with
+	 * RETURN:
+	 *
+	 */
+void test_broadcast (unsigned int rows, unsigned int cols) {
+
+	Matrix_t* a = new_operand(rows, cols, rand() % 2);
+	Matrix_t* row = new_operand(1, cols, rand() % 2);
+	Matrix_t* col = new_operand(rows, 1, rand() % 2);
+	Matrix_t* result = new_operand(rows, cols, rand() % 2);
+
+	unsigned int* expected = flatten(a);
+	for (unsigned int i = 0; i < rows; ++i) {
+		for (unsigned int j = 0; j < cols; ++j) {
+			expected[(size_t)i * cols + j] += row->data[j];
+		}
+	}
+	check(broadcast_add_matrix(a, row, result), "broadcast_add_matrix row", result, "returned false");
+	check_data("broadcast_add_matrix row", result, expected);
+	check_stats("broadcast_add_matrix row", result);
+
+	for (unsigned int i = 0; i < rows; ++i) {
+		for (unsigned int j = 0; j < cols; ++j) {
+			expected[(size_t)i * cols + j] += col->data[(size_t)i * col->stride];
+		}
+	}
+	check(broadcast_add_matrix(result, col, result), "broadcast_add_matrix col", result, "returned false");
+	check_data("broadcast_add_matrix col", result, expected);
+	check_stats("broadcast_add_matrix col", result);
+
+	free(expected);
+	destroy_matrix(&a);
+	destroy_matrix(&row);
+	destroy_matrix(&col);
+	destroy_matrix(&result);
+}
+
+	/*
+	 * PURPOSE: checks bitwise_shift_matrix both ways by every amount up to past the width of a number,
+	 *  with the statistics cached beforehand so the shifted cache is checked too
+	 * INPUT:
+	 *	rows - the number of rows to test with
+	 *	cols - the number of cols to test with
+	 * RETURN:
+	 *
+	 */
+void test_shift (unsigned int rows, unsigned int cols) {
+
+	const char direction = rand() % 2 ? 'l' : 'r';
+	const unsigned int shift = rand() % 34;
+	Matrix_t* a = new_operand(rows, cols, rand() % 2);
+	sum_matrix(a);
+
+	unsigned int* expected = flatten(a);
+	for (size_t e = 0; e < (size_t)rows * cols; ++e) {
+		expected[e] = shift >= 32 ? 0 : direction == 'l' ? expected[e] << shift : expected[e] >> shift;
+	}
+	check(bitwise_shift_matrix(a, direction, shift), "bitwise_shift_matrix", a, "returned false");
+	check_data("bitwise_shift_matrix", a, expected);
+	check_stats("bitwise_shift_matrix", a);
+
+	free(expected);
+	destroy_matrix(&a);
+}
+
+	/*
+	 * PURPOSE: checks duplicate_matrix and equal_matrices
+	 * INPUT:
+	 *	rows - the number of rows to test with
+	 *	cols - the number of cols to test with
+	 * RETURN:
+	 *
+	 */
+void test_duplicate (unsigned int rows, unsigned int cols) {
+
+	Matrix_t* src = new_operand(rows, cols, rand() % 2);
+	Matrix_t* dest = new_operand(rows, cols, rand() % 2);
+	if (rand() % 2) {
+		sum_matrix(src);
+	}
+	unsigned int* expected = flatten(src);
+
+	check(duplicate_matrix(src, dest), "duplicate_matrix", dest, "returned false");
+	check_data("duplicate_matrix", dest, expected);
+	check_stats("duplicate_matrix", dest);
+	check(equal_matrices(src, dest), "equal_matrices", dest, "a copy is not equal");
+	const unsigned int i = rand() % rows;
+	const unsigned int j = rand() % cols;
+	dest->data[(size_t)i * dest->stride + j] ^= 1;
+	check(!equal_matrices(src, dest), "equal_matrices", dest, "a changed copy is still equal");
+
+	free(expected);
+	destroy_matrix(&src);
+	destroy_matrix(&dest);
+}
+
+	/*
+	 * PURPOSE: checks that a matrix read back with read_matrix and read_matrices is the one write_matrix wrote
+	 * INPUT:
+	 *	rows - the number of rows to test with
+	 *	cols - the number of cols to test with
+	 *	dir - a directory to write the file to
+	 * RETURN:
+	 *
+	 */
+void test_file (unsigned int rows, unsigned int cols, const char* dir) {
+
+	char filename[64];
+	snprintf(filename, sizeof(filename), "%s/m", dir);
+	Matrix_t* m = new_operand(rows, cols, rand() % 2);
+	unsigned int* expected = flatten(m);
+
+	check(write_matrix(filename, m), "write_matrix", m, "returned false");
+	Matrix_t* copy = NULL;
+	check(read_matrix(filename, &copy), "read_matrix", m, "returned false");
+	if (copy) {
+		check(copy->rows == rows && copy->cols == cols, "read_matrix", copy, "the size changed");
+		check_data("read_matrix", copy, expected);
+		destroy_matrix(&copy);
+	}
+	/* both copies have the same name, so the second replaces the first in the array */
+	const char* filenames[] = {filename, filename};
+	Matrix_t* copies[4] = {NULL};
+	unsigned long long bytes = 0;
+	check(read_matrices(filenames, 2, copies, 4, &bytes) == 2, "read_matrices", m, "did not read every file");
+	check(copies[0] && !copies[1], "read_matrices", m, "did not replace the first copy");
+	if (copies[0]) {
+		check_data("read_matrices", copies[0], expected);
+		destroy_matrix(&copies[0]);
+	}
+	unlink(filename);
+
+	free(expected);
+	destroy_matrix(&m);
+}
+
+	/*
+	 * PURPOSE: checks that a workspace entry whose payload is not page aligned, which load_workspace
+	 *  copies instead of mapping, comes back with its numbers and statistics
+	 * INPUT:
+	 *	rows - the number of rows to test with
+	 *	cols - the number of cols to test with
+	 *	dir - a directory to write the archive to
+	 * RETURN:
+	 *
+	 */
+void test_workspace (unsigned int rows, unsigned int cols, const char* dir) {
+
+	/* the archive layout of matrix.c, with the payload right after the table of contents */
+	struct {
+		char magic[8];
+		uint32_t count;
+		uint32_t align;
+	}header = {{0}, 1, 4096};
+	struct {
+		char name[32];
+		uint64_t rows;
+		uint64_t cols;
+		uint64_t offset;
+	}entry = {"unaligned", rows, cols, sizeof(header) + sizeof(entry)};
+	memcpy(header.magic, "MATWKSP1", sizeof(header.magic));
+
+	Matrix_t* m = new_operand(rows, cols, false);
+	char filename[64];
+	snprintf(filename, sizeof(filename), "%s/w", dir);
+	FILE* file = fopen(filename, "w");
+	if (!file) {
+		perror("FAILED TO WRITE THE WORKSPACE");
+		exit(1);
+	}
+	fwrite(&header, sizeof(header), 1, file);
+	fwrite(&entry, sizeof(entry), 1, file);
+	fwrite(m->data, sizeof(unsigned int), (size_t)rows * cols, file);
+	fclose(file);
+
+	Matrix_t* mats[4] = {NULL};
+	check(load_workspace(filename, mats, 4) == 1, "load_workspace", m, "did not load the entry");
+	if (mats[0]) {
+		check_data("load_workspace", mats[0], m->data);
+		check(sum_matrix(mats[0]) == sum_matrix(m), "load_workspace", mats[0], "the sum is wrong");
+		check_stats("load_workspace", mats[0]);
+		destroy_matrix(&mats[0]);
+	}
+	unlink(filename);
+	destroy_matrix(&m);
+}
+
+	/*
+	 * PURPOSE: times each kernel on big matrices
+	 * INPUT:
+	 *	results - where the best time of each kernel is stored
+	 * RETURN:
+	 *  the number of kernels timed
+	 */
+unsigned int run_perf (Perf_Result_t* results) {
+
+	static const char* kernels[] = {"add_matrices", "reduce_add_4", "reduce_max_4", "sum_all",
+		"broadcast_row", "shift", "duplicate_matrix", "equal_matrices", "matrix_stats"};
+	const unsigned int num_kernels = sizeof(kernels) / sizeof(kernels[0]);
+
+	Matrix_t* ms[MAX_OPERANDS];
+	for (unsigned int k = 0; k < MAX_OPERANDS; ++k) {
+		ms[k] = NULL;
+		if (!create_matrix(&ms[k], "perf", PERF_SIZE, PERF_SIZE)) {
+			exit(1);
+		}
+		random_matrix(ms[k], 0, 1000);
+	}
+	Matrix_t* vector = NULL;
+	if (!create_matrix(&vector, "vector", 1, PERF_SIZE)) {
+		exit(1);
+	}
+	random_matrix(vector, 0, 1000);
+	for (unsigned int kernel = 0; kernel < num_kernels; ++kernel) {
+		results[kernel].name = kernels[kernel];
+		results[kernel].usec = time_kernel(kernel, ms, vector);
+	}
+	destroy_matrix(&vector);
+	for (unsigned int k = 0; k < MAX_OPERANDS; ++k) {
+		destroy_matrix(&ms[k]);
+	}
+	return num_kernels;
+}
+
+	/*
+	 * PURPOSE: gets the best of a few runs of one kernel
+	 * INPUT:
+	 *	kernel - the index of the kernel in run_perf
+	 *	ms - the matricies to run it on, the last one holds results
+	 *	vector - a row vector as long as the rows of the matricies
+	 * RETURN:
+	 *  the time of the fastest run in microseconds
+	 */
+double time_kernel (unsigned int kernel, Matrix_t** ms, Matrix_t* vector) {
+
+	Matrix_t* result = ms[MAX_OPERANDS - 1];
+	double best = 0;
+	for (unsigned int run = 0; run < PERF_RUNS; ++run) {
+		/* sums would come from the cache, clearing it is not timed */
+		if (kernel == 3 || kernel == 8) {
+			random_matrix(result, 0, 1000);
+		}
+
+		struct timespec start, end;
+		unsigned long long sum = 0;
+		clock_gettime(CLOCK_MONOTONIC, &start);
+		switch (kernel) {
+			case 0:
+				add_matrices(ms[0], ms[1], result);
+				break;
+			case 1:
+				reduce_matrices(ms, 4, REDUCE_ADD, result);
+				break;
+			case 2:
+				reduce_matrices(ms, 4, REDUCE_MAX, result);
+				break;
+			case 3:
+				sum_all_matrices(&result, 1, &sum);
+				break;
+			case 4:
+				broadcast_add_matrix(ms[0], vector, result);
+				break;
+			case 5:
+				bitwise_shift_matrix(result, 'r', 1);
+				break;
+			case 6:
+				duplicate_matrix(ms[0], result);
+				break;
+			case 7:
+				/* the result is still the copy duplicate_matrix made, so every number is compared */
+				equal_matrices(ms[0], result);
+				break;
+			case 8:
+				sum_matrix(result);
+				break;
+		}
+		clock_gettime(CLOCK_MONOTONIC, &end);
+		const double usec = (end.tv_sec - start.tv_sec) * 1e6 + (end.tv_nsec - start.tv_nsec) / 1e3;
+		if (run == 0 || usec < best) {
+			best = usec;
+		}
+	}
+	return best;
+}
+
+	/*
+	 * PURPOSE: times the kernels and checks them against a baseline file of name and microsecond lines
+	 * INPUT:
+	 *	baseline_file - the baseline file
+	 *	write_baseline - writes the timings as the new baseline instead of checking them
+	 * RETURN:
+	 *  True - if no kernel is more than PERF_TOLERANCE times slower than its baseline
+	 *  False - if one is or the baseline could not be written
+	 */
+bool perf_gate (const char* baseline_file, bool write_baseline) {
+
+	Perf_Result_t results[16];
+	const unsigned int num_results = run_perf(results);
+
+	if (write_baseline) {
+		FILE* file = fopen(baseline_file, "w");
+		if (!file) {
+			perror("FAILED TO WRITE THE BASELINE");
+			return false;
+		}
+		for (unsigned int k = 0; k < num_results; ++k) {
+			fprintf(file, "%s %.0f\n", results[k].name, results[k].usec);
+		}
+		fclose(file);
+		printf("Wrote the baseline of %u kernels to %s\n", num_results, baseline_file);
+		return true;
+	}
+
+	FILE* file = fopen(baseline_file, "r");
+	if (!file) {
+		printf("No baseline in %s, make one with -w\n", baseline_file);
+		return true;
+	}
+	bool passed = true;
+	char name[64];
+	double usec;
+	while (fscanf(file, "%63s %lf", name, &usec) == 2) {
+		for (unsigned int k = 0; k < num_results; ++k) {
+			if (strcmp(name, results[k].name) != 0) {
+				continue;
+			}
+			const bool slow = results[k].usec > usec * PERF_TOLERANCE + PERF_SLACK_USEC;
+			printf("%-18s %10.0f us, baseline %10.0f us%s\n", name, results[k].usec, usec, slow ? "  TOO SLOW" : "");
+			passed = passed && !slow;
+		}
+	}
+	fclose(file);
+	if (!passed) {
+		printf("A kernel is more than %.0f times slower than the baseline\n", PERF_TOLERANCE);
+	}
+	return passed;
+}